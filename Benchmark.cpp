@@ -0,0 +1,254 @@
+//Throughput benchmark of the simulator engines.
+//
+//Generates each workload of a fixed matrix once, then times three phases separately:
+//  parse     decoding the trace file into records (once per workload)
+//  simulate  running the records through a Cache of each geometry (best of --repeat runs)
+//  report    formatting the results block
+//and prints accesses/sec and ns/access for every pair, plus the same numbers (and the hit
+//counts, so behaviour changes show up too) as JSON for diffing between releases.
+//
+//Usage: CacheSimulatorBenchmark [--accesses N] [--repeat R] [--text] [--json FILE]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "Trace.h"
+#include "TraceGenerator.h"
+
+namespace {
+
+struct BenchmarkGeometry {
+    long long size_kb;
+    int block_size;
+    int associativity;
+    ReplacementPolicy policy;
+};
+
+//The common L1 shapes on every policy, a direct-mapped and a generic (12-way) engine, and
+//two last-level sizes
+const BenchmarkGeometry GEOMETRIES[] = {
+    { 32, 64, 8, ReplacementPolicy::Lru },
+    { 32, 64, 8, ReplacementPolicy::TreePlru },
+    { 32, 64, 8, ReplacementPolicy::Srrip },
+    { 32, 64, 1, ReplacementPolicy::Lru },
+    { 48, 64, 12, ReplacementPolicy::Lru },
+    { 1024, 64, 16, ReplacementPolicy::Lru },
+    { 8192, 64, 16, ReplacementPolicy::Brrip },
+};
+
+struct BenchmarkWorkload {
+    WorkloadPattern pattern;
+    long long footprint_kb;
+    long long stride;
+    int write_percent;
+};
+
+const BenchmarkWorkload WORKLOADS[] = {
+    { WorkloadPattern::Mixed, 256, 64, 0 },
+    { WorkloadPattern::Sequential, 65536, 64, 10 },
+    { WorkloadPattern::Strided, 65536, 4160, 10 },
+    { WorkloadPattern::Zipfian, 65536, 64, 20 },
+    { WorkloadPattern::PointerChase, 65536, 64, 0 },
+    { WorkloadPattern::Random, 65536, 64, 20 },
+};
+
+const char* const TRACE_FILENAME = "benchmark_trace.tmp";
+
+double elapsedNs(std::chrono::steady_clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//What the simulator prints at the end of a run
+std::string formatResults(const CacheStats& stats, int block_size) {
+    std::ostringstream out;
+    out << "Total Accesses: " << stats.accesses() << "\n";
+    out << "Hits: " << stats.hits << "\n";
+    out << "Misses: " << stats.misses << "\n";
+    out << "Hit Rate: " << std::fixed << std::setprecision(4) << (stats.hitRate() * 100.0) << "%\n";
+    out << "Fetches: " << stats.fetches << "\n";
+    out << "Write-Backs: " << stats.writebacks << "\n";
+    out << "Write-Throughs: " << stats.write_throughs << "\n";
+    out << "Memory Traffic: " << stats.trafficBytes(block_size) << " bytes\n";
+    return out.str();
+}
+
+struct PhaseResult {
+    std::string workload;
+    long long size_kb = 0;
+    int block_size = 0;
+    int associativity = 0;
+    std::string policy;
+    bool specialized = false;
+    double parse_ns = 0.0;
+    double simulate_ns = 0.0;
+    double report_ns = 0.0;
+    long long hits = 0;
+    long long accesses = 0;
+};
+
+bool writeJson(const std::string& filename, long long accesses, int repeat, bool text, const std::vector<PhaseResult>& results) {
+    std::ofstream file;
+    std::ostream* out = &std::cout;
+    if (filename != "-") {
+        file.open(filename);
+        if (!file.is_open()) {
+            std::cerr << "Error: Could not create " << filename << std::endl;
+            return false;
+        }
+        out = &file;
+    }
+
+    *out << std::fixed << std::setprecision(3);
+    *out << "{\n  \"accesses\": " << accesses << ",\n  \"repeat\": " << repeat << ",\n  \"trace_format\": \""
+        << (text ? "text" : "binary") << "\",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const PhaseResult& r = results[i];
+        double per_access = r.simulate_ns / r.accesses;
+        *out << "    { \"workload\": \"" << r.workload << "\", \"cache_kb\": " << r.size_kb << ", \"block_size\": " << r.block_size
+            << ", \"associativity\": " << r.associativity << ", \"policy\": \"" << r.policy << "\", \"engine\": \""
+            << (r.specialized ? "specialized" : "generic") << "\", \"hits\": " << r.hits
+            << ", \"parse_ns_per_access\": " << (r.parse_ns / r.accesses) << ", \"simulate_ns\": " << r.simulate_ns
+            << ", \"report_ns\": " << r.report_ns << ", \"ns_per_access\": " << per_access
+            << ", \"accesses_per_sec\": " << (1e9 / per_access) << " }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+    }
+    *out << "  ]\n}\n";
+
+    if (!*out) {
+        std::cerr << "Error: Failed writing " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    long long accesses = 4000000;
+    int repeat = 3;
+    bool text = false;
+    std::string json_filename;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--accesses" && i + 1 < argc) {
+            accesses = std::atoll(argv[++i]);
+        }
+        else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::atoi(argv[++i]);
+        }
+        else if (arg == "--json" && i + 1 < argc) {
+            json_filename = argv[++i];
+        }
+        else if (arg == "--text") {
+            text = true;
+        }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--accesses N] [--repeat R] [--text] [--json FILE]" << std::endl;
+            return 1;
+        }
+    }
+    if (accesses < 1 || repeat < 1) {
+        std::cerr << "Error: --accesses and --repeat must be positive." << std::endl;
+        return 1;
+    }
+
+    std::cout << "--- Benchmark: " << accesses << " accesses per workload, best of " << repeat << " ---" << std::endl;
+    std::cout << std::left << std::setw(15) << "Workload" << std::setw(9) << "Size KB" << std::setw(7) << "Block"
+        << std::setw(6) << "Ways" << std::setw(7) << "Policy" << std::setw(13) << "Engine" << std::setw(14) << "Parse ns/acc"
+        << std::setw(10) << "ns/acc" << std::setw(14) << "Accesses/s" << "Hit Rate" << std::endl;
+
+    std::vector<PhaseResult> results;
+    std::vector<TraceRecord> records;
+    for (const BenchmarkWorkload& workload : WORKLOADS) {
+        //1. Generate the trace file (not timed)
+        WorkloadConfig config;
+        config.pattern = workload.pattern;
+        config.accesses = accesses;
+        config.footprint = workload.footprint_kb * 1024;
+        config.stride = workload.stride;
+        config.write_percent = workload.write_percent;
+        TraceGenerator generator(config);
+        unsigned long long written = 0;
+        bool ok = text ? writeTextTrace(generator, TRACE_FILENAME, written) : writeBinaryTrace(generator, TRACE_FILENAME, written);
+        if (!ok) {
+            return 1;
+        }
+
+        //2. Parse: decode the whole file into memory
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::unique_ptr<TraceReader> trace = openTrace(TRACE_FILENAME);
+        if (!trace) {
+            return 1;
+        }
+        records.resize((std::size_t)accesses + TRACE_BATCH_SIZE);
+        std::size_t count = 0;
+        std::size_t batch_count;
+        while ((batch_count = trace->read(records.data() + count, TRACE_BATCH_SIZE)) > 0) {
+            count += batch_count;
+        }
+        double parse_ns = elapsedNs(start);
+        trace.reset();
+        std::remove(TRACE_FILENAME);
+
+        for (const BenchmarkGeometry& shape : GEOMETRIES) {
+            CacheGeometry geometry;
+            if (!computeGeometry(shape.size_kb * 1024, shape.block_size, shape.associativity, geometry)) {
+                return 1;
+            }
+
+            //3. Simulate, a fresh cache each time, in the batches the simulator uses
+            PhaseResult result;
+            CacheStats stats;
+            for (int run = 0; run < repeat; ++run) {
+                Cache cache(geometry, shape.policy);
+                start = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < count; i += TRACE_BATCH_SIZE) {
+                    cache.access(records.data() + i, (count - i < TRACE_BATCH_SIZE) ? count - i : TRACE_BATCH_SIZE);
+                }
+                double ns = elapsedNs(start);
+                if (run == 0 || ns < result.simulate_ns) {
+                    result.simulate_ns = ns;
+                }
+                stats = cache.stats();
+                result.specialized = cache.isSpecialized();
+            }
+
+            //4. Report
+            start = std::chrono::steady_clock::now();
+            std::string report = formatResults(stats, shape.block_size);
+            result.report_ns = elapsedNs(start);
+
+            result.workload = workloadPatternName(workload.pattern);
+            result.size_kb = shape.size_kb;
+            result.block_size = shape.block_size;
+            result.associativity = shape.associativity;
+            result.policy = replacementPolicyName(shape.policy);
+            result.parse_ns = parse_ns;
+            result.hits = stats.hits;
+            result.accesses = (long long)count;
+            results.push_back(result);
+
+            double per_access = result.simulate_ns / result.accesses;
+            std::ostringstream hit_rate;
+            hit_rate << std::fixed << std::setprecision(2) << (stats.hitRate() * 100.0) << "%";
+            std::cout << std::left << std::setw(15) << result.workload << std::setw(9) << result.size_kb << std::setw(7) << result.block_size
+                << std::setw(6) << result.associativity << std::setw(7) << result.policy
+                << std::setw(13) << (result.specialized ? "specialized" : "generic") << std::fixed << std::setprecision(2)
+                << std::setw(14) << (parse_ns / result.accesses) << std::setw(10) << per_access
+                << std::setw(14) << std::setprecision(0) << (1e9 / per_access) << hit_rate.str() << std::endl;
+        }
+    }
+
+    if (!json_filename.empty() && !writeJson(json_filename, accesses, repeat, text, results)) {
+        return 1;
+    }
+    return 0;
+}
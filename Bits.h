@@ -0,0 +1,91 @@
+#pragma once
+
+//Small bit manipulation, byte order and memory hint helpers shared by the cache engine
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+//Index of the lowest set bit. value must not be zero.
+inline int countTrailingZeros(unsigned long long value) {
+#ifdef _MSC_VER
+    unsigned long index;
+#ifdef _WIN64
+    _BitScanForward64(&index, value);
+#else
+    if (!_BitScanForward(&index, (unsigned long)value)) {
+        _BitScanForward(&index, (unsigned long)(value >> 32));
+        index += 32;
+    }
+#endif
+    return (int)index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+
+//1 if value has an odd number of set bits, else 0
+inline int parity64(unsigned long long value) {
+#ifdef _MSC_VER
+    //__popcnt64 would need a CPU with POPCNT
+    value ^= value >> 32;
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return (int)(value & 1);
+#else
+    return __builtin_parityll(value);
+#endif
+}
+
+
+//High 64 bits of the 128-bit product a * b
+inline unsigned long long multiplyHigh64(unsigned long long a, unsigned long long b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return __umulh(a, b);
+#elif defined(__SIZEOF_INT128__)
+    return (unsigned long long)(((unsigned __int128)a * b) >> 64);
+#else
+    unsigned long long a_low = a & 0xFFFFFFFFULL, a_high = a >> 32;
+    unsigned long long b_low = b & 0xFFFFFFFFULL, b_high = b >> 32;
+    unsigned long long low = a_low * b_low;
+    unsigned long long middle = a_high * b_low + (low >> 32);
+    unsigned long long middle2 = a_low * b_high + (middle & 0xFFFFFFFFULL);
+    return a_high * b_high + (middle >> 32) + (middle2 >> 32);
+#endif
+}
+
+
+//Asks the host to start loading the cache line at address. Only a hint, never faults.
+inline void prefetchRead(const void* address) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch((const char*)address, _MM_HINT_T0);
+#elif defined(__GNUC__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+
+//The 8 bytes at bytes as a little-endian integer, for the binary file formats.
+//Compiles down to a single load on little-endian hosts.
+inline unsigned long long loadLittleEndian64(const unsigned char* bytes) {
+    unsigned long long value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+inline void storeLittleEndian64(unsigned char* bytes, unsigned long long value) {
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = (unsigned char)(value >> (i * 8));
+    }
+}
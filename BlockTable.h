@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Bits.h"
+
+//Open-addressing hash table from block numbers to one unsigned int each, for the analyses
+//that track every block a trace touches (see MissClassifier.h and StackDistance.h).
+//
+//Fibonacci hashing picks the home entry and collisions probe linearly. The table starts at
+//2^16 entries on the first insertion and doubles whenever it would pass half full, so probe
+//chains stay short. Blocks are never removed.
+class BlockTable {
+public:
+    //The value of an empty entry, so it cannot be stored
+    static const unsigned int EMPTY = 0xFFFFFFFFu;
+
+    BlockTable() : used_(0), bits_(0) {}
+
+    //Entry of block, inserted with value initial if it is new, which sets inserted.
+    //Growing the table moves every entry: moved(block, value, entry) is called for each one
+    //at its new entry, so whatever refers to entries can follow them.
+    template <class MOVED>
+    std::size_t insert(unsigned long long block, unsigned int initial, bool& inserted, MOVED moved) {
+        while (true) {
+            if (bits_ > 0) {
+                std::size_t mask = table_.size() - 1;
+                std::size_t i = home(block);
+                for (;; i = (i + 1) & mask) {
+                    if (table_[i].value == EMPTY) {
+                        break;
+                    }
+                    if (table_[i].block == block) {
+                        inserted = false;
+                        return i;
+                    }
+                }
+
+                //A new block: insert it unless the table is getting full
+                if ((used_ + 1) * 2 <= table_.size()) {
+                    used_++;
+                    table_[i].block = block;
+                    table_[i].value = initial;
+                    inserted = true;
+                    return i;
+                }
+            }
+            grow(moved);
+        }
+    }
+
+    unsigned int& value(std::size_t entry) { return table_[entry].value; }
+    unsigned int value(std::size_t entry) const { return table_[entry].value; }
+
+    //Starts loading the home entry of a block that is about to be looked up
+    void prefetch(unsigned long long block) const {
+        if (bits_ > 0) {
+            prefetchRead(&table_[home(block)]);
+        }
+    }
+
+private:
+    struct Entry {
+        unsigned long long block;
+        unsigned int value; //EMPTY marks an empty entry
+    };
+
+    std::size_t home(unsigned long long block) const {
+        return (std::size_t)((block * 0x9E3779B97F4A7C15ULL) >> (64 - bits_));
+    }
+
+    template <class MOVED>
+    void grow(MOVED& moved) {
+        std::vector<Entry> old_table;
+        old_table.swap(table_);
+        bits_ = (bits_ == 0) ? 16 : bits_ + 1;
+        Entry empty = { 0, EMPTY };
+        table_.assign((std::size_t)1 << bits_, empty);
+
+        //Rehash the old entries and tell the owner where they went
+        std::size_t mask = table_.size() - 1;
+        for (const Entry& entry : old_table) {
+            if (entry.value == EMPTY) {
+                continue;
+            }
+            std::size_t i = home(entry.block);
+            while (table_[i].value != EMPTY) {
+                i = (i + 1) & mask;
+            }
+            table_[i] = entry;
+            moved(entry.block, entry.value, i);
+        }
+    }
+
+    std::vector<Entry> table_;
+    std::size_t used_;
+    int bits_;
+};
@@ -0,0 +1,980 @@
+#include "Cache.h"
+
+#include <iostream>
+#include <cstdio>
+
+#include "Config.h"
+#include "TagMatch.h"
+
+namespace {
+
+//log2 of a power of two, usable in template arguments
+constexpr int log2Constant(int value) {
+    return (value <= 1) ? 0 : 1 + log2Constant(value / 2);
+}
+
+} // namespace
+
+
+bool parseWritePolicy(const std::string& name, WritePolicy& policy) {
+    std::string upper = toUpper(name);
+    const WritePolicy all[] = { WritePolicy::WriteBack, WritePolicy::WriteThrough };
+    for (WritePolicy candidate : all) {
+        if (upper == writePolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported write policy " << name << " (expected WRITE_BACK or WRITE_THROUGH)" << std::endl;
+    return false;
+}
+
+
+bool parseWriteMissPolicy(const std::string& name, WriteMissPolicy& policy) {
+    std::string upper = toUpper(name);
+    const WriteMissPolicy all[] = { WriteMissPolicy::WriteAllocate, WriteMissPolicy::NoWriteAllocate };
+    for (WriteMissPolicy candidate : all) {
+        if (upper == writeMissPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported write miss policy " << name << " (expected WRITE_ALLOCATE or NO_WRITE_ALLOCATE)" << std::endl;
+    return false;
+}
+
+
+const char* writePolicyName(WritePolicy policy) {
+    switch (policy) {
+    case WritePolicy::WriteBack: return "WRITE_BACK";
+    case WritePolicy::WriteThrough: return "WRITE_THROUGH";
+    }
+    return "unknown";
+}
+
+
+const char* writeMissPolicyName(WriteMissPolicy policy) {
+    switch (policy) {
+    case WriteMissPolicy::WriteAllocate: return "WRITE_ALLOCATE";
+    case WriteMissPolicy::NoWriteAllocate: return "NO_WRITE_ALLOCATE";
+    }
+    return "unknown";
+}
+
+
+bool computeGeometry(long long cache_size, int block_size, int associativity, CacheGeometry& geometry) {
+    //Add a check to prevent division by zero
+    if (block_size <= 0) {
+        std::cerr << "Error: Block size must be positive." << std::endl;
+        return false;
+    }
+    if (associativity <= 0) {
+        std::cerr << "Error: Associativity cannot be zero." << std::endl;
+        return false;
+    }
+
+    //The offset is a bit field, so a block size in between would mix up neighbouring blocks
+    if ((block_size & (block_size - 1)) != 0) {
+        std::cerr << "Error: Block size must be a power of two, got " << block_size << "." << std::endl;
+        return false;
+    }
+
+    //Total number of blocks in the cache
+    long long num_blocks = cache_size / block_size;
+
+    //Number of sets
+    long long num_sets = num_blocks / associativity;
+
+    //Add a check for num_sets being zero (e.g., cache size too small)
+    if (num_sets <= 0) {
+        std::cerr << "Error: Number of sets is zero. Check cache/block size." << std::endl;
+        return false;
+    }
+    if (num_sets * associativity * block_size != cache_size) {
+        std::cerr << "Error: A cache of " << cache_size << " bytes is not a whole number of " << associativity << "-way sets of "
+            << block_size << "B blocks." << std::endl;
+        return false;
+    }
+    if (num_sets > 0x7FFFFFFFLL) {
+        std::cerr << "Error: Too many sets (" << num_sets << ")." << std::endl;
+        return false;
+    }
+
+    geometry.cache_size = cache_size;
+    geometry.block_size = block_size;
+    geometry.associativity = associativity;
+    geometry.num_sets = (int)num_sets;
+
+    // Number of bits needed for:
+    //the Offset (to find a byte within a block)
+    geometry.offset_bits = countTrailingZeros((unsigned long long)block_size);
+    //the Index (to find the set), unless the sets are not a power of two and the index is
+    //the block modulo their number
+    int set_bits = 0;
+    while ((2LL << set_bits) <= num_sets) {
+        set_bits++;
+    }
+    geometry.index_bits = geometry.powerOfTwoSets() ? set_bits : 0;
+    //the Tag (the rest of the bits)
+    //Assume a 64-bit address space
+    geometry.tag_bits = 64 - set_bits - geometry.offset_bits;
+    return true;
+}
+
+
+bool checkIndexConfig(const IndexConfig& index, const CacheGeometry& geometry, ReplacementPolicy policy) {
+    if (index.function == IndexFunction::Modulo) {
+        return true;
+    }
+    if (!geometry.powerOfTwoSets()) {
+        std::cerr << "Error: The " << indexFunctionName(index.function) << " index function needs a power-of-two number of sets, not "
+            << geometry.num_sets << "." << std::endl;
+        return false;
+    }
+    if (index.function == IndexFunction::HashMatrix) {
+        if ((int)index.hash_masks.size() != geometry.index_bits) {
+            std::cerr << "Error: INDEX_HASH_MASKS needs one mask per index bit, " << geometry.index_bits << " for "
+                << geometry.num_sets << " sets, got " << index.hash_masks.size() << "." << std::endl;
+            return false;
+        }
+        if (!HashMatrixIndex(index.hash_masks).invertible()) {
+            std::cerr << "Error: INDEX_HASH_MASKS must mix the low " << geometry.index_bits << " bits of the block number "
+                << "invertibly, or blocks with the same tag would share a set." << std::endl;
+            return false;
+        }
+    }
+    if (index.function == IndexFunction::Skewed && policy != ReplacementPolicy::Lru) {
+        std::cerr << "Error: The SKEWED index function needs REPLACEMENT_POLICY LRU." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+Cache::Cache(const CacheGeometry& geometry, ReplacementPolicy policy, WritePolicy write_policy, WriteMissPolicy write_miss_policy)
+    : geometry_(geometry), storage_(geometry.num_sets, geometry.associativity), policy_(policy),
+      write_back_(write_policy == WritePolicy::WriteBack), write_allocate_(write_miss_policy == WriteMissPolicy::WriteAllocate),
+      prefetch_latency_(0), prefetch_clock_(0), index_function_(IndexFunction::Modulo), skewed_clock_(0), access_fn_(nullptr),
+      batch_fn_(nullptr), specialized_(false) {
+    std::get<PowerOfTwoIndex>(indexes_) = PowerOfTwoIndex(geometry_.powerOfTwoSets() ? geometry_.num_sets : 1);
+    std::get<ModuloIndex>(indexes_) = ModuloIndex(geometry_.num_sets);
+    selectEngine();
+}
+
+
+void Cache::setIndexFunction(const IndexConfig& index) {
+    index_function_ = index.function;
+    switch (index.function) {
+    case IndexFunction::Modulo: break;
+    case IndexFunction::XorFold: std::get<XorFoldIndex>(indexes_) = XorFoldIndex(geometry_.num_sets); break;
+    case IndexFunction::HashMatrix: std::get<HashMatrixIndex>(indexes_) = HashMatrixIndex(index.hash_masks); break;
+    case IndexFunction::Skewed:
+        std::get<SkewedIndex>(indexes_) = SkewedIndex(geometry_.num_sets, geometry_.associativity);
+        skewed_used_.assign((std::size_t)geometry_.num_sets * geometry_.associativity, 0);
+        break;
+    }
+    selectEngine();
+}
+
+
+void Cache::enablePrefetching(const PrefetchConfig& config) {
+    prefetcher_ = makePrefetcher(config);
+    if (!prefetcher_) {
+        return;
+    }
+    prefetch_latency_ = config.latency;
+    std::size_t blocks = (std::size_t)geometry_.num_sets * storage_.associativity;
+    prefetched_.assign((std::size_t)geometry_.num_sets * storage_.valid_words, 0);
+    prefetched_at_.assign(blocks, 0);
+    polluted_.assign(blocks, 0);
+    polluted_next_.assign(geometry_.num_sets, 0);
+}
+
+
+void Cache::enableMissClassification() {
+    classifier_.reset(new MissClassifier((long long)geometry_.num_sets * geometry_.associativity));
+}
+
+
+void Cache::enableVictimCache(int blocks) {
+    victim_cache_.reset(new VictimCache(blocks));
+}
+
+
+#ifdef CACHESIM_PROFILE
+void Cache::enableProfile(int top_evicted) {
+    profile_.reset(new CacheProfile(geometry_.num_sets, geometry_.offset_bits, top_evicted));
+}
+#endif
+
+
+void Cache::resetStats() {
+    stats_ = CacheStats();
+#ifdef CACHESIM_PROFILE
+    if (profile_ != nullptr) {
+        profile_->resetCounts();
+    }
+#endif
+}
+
+
+//The simulator logic for one access.
+//WAYS and BLOCK_SIZE are compile-time constants for the common geometries, which lets the
+//compiler unroll the way scans and turn the offset shift into an immediate. A value of 0
+//means "not specialized": the runtime associativity and offset_bits are used instead.
+//POLICY is the replacement policy, see ReplacementPolicy.h, and INDEX the set index
+//function, see SetIndex.h.
+template <class POLICY, class INDEX, int WAYS, int BLOCK_SIZE>
+void Cache::accessFixed(unsigned long long address, char access_type) {
+    //1. Calculate Tag and Index from the address
+
+    //Shift off the offset bits
+    const int shift = BLOCK_SIZE ? log2Constant(BLOCK_SIZE) : geometry_.offset_bits;
+    unsigned long long address_no_offset = address >> shift;
+
+    //The index picks the set, the rest of the block number is the tag
+    unsigned long long index, tag;
+    std::get<INDEX>(indexes_).split(address_no_offset, index, tag);
+
+    accessDecoded<POLICY, WAYS, BLOCK_SIZE>(address, address_no_offset, index, tag, access_type);
+}
+
+
+template <class POLICY, int WAYS, int BLOCK_SIZE>
+void Cache::accessDecoded(unsigned long long address, unsigned long long address_no_offset, unsigned long long index,
+    unsigned long long tag, char access_type) {
+    static_assert(WAYS >= 0 && WAYS <= 64, "Specialized engines keep the valid bits in one word");
+    static_assert((BLOCK_SIZE & (BLOCK_SIZE - 1)) == 0, "Block size must be a power of two");
+
+    POLICY& policy = std::get<POLICY>(policies_);
+    const int shift = BLOCK_SIZE ? log2Constant(BLOCK_SIZE) : geometry_.offset_bits;
+
+    //Blocks coming down from the level above are fills, not demand accesses
+    const bool insertion = (access_type == ACCESS_EVICT || access_type == ACCESS_WRITEBACK);
+    const bool write = (access_type == 'W' || access_type == ACCESS_WRITEBACK);
+
+    //The shadow cache of the miss classification has to see every demand access
+    ShadowResult shadow = ShadowResult::Hit;
+    if (classifier_ != nullptr && !insertion) {
+        shadow = classifier_->access(address_no_offset);
+    }
+
+    //2. Get the corresponding set from the cache
+    unsigned long long* set_tags = storage_.setTags(index);
+    const int associativity = WAYS ? WAYS : storage_.associativity;
+
+    //3. Check for a Hit
+    //Compare the tag against up to 64 ways at once, see TagMatch.h
+    const unsigned long long* set_valid = storage_.setValid(index);
+    for (int base = 0; base < associativity; base += 64) {
+        int count = (associativity - base < 64) ? associativity - base : 64;
+        unsigned long long hit_ways = matchTags(set_tags + base, count, tag) & set_valid[base >> 6];
+        if (hit_ways != 0) {
+            int hit_way = base + countTrailingZeros(hit_ways);
+            if (!insertion) {
+                stats_.hits++;
+#ifdef CACHESIM_PROFILE
+                if (profile_ != nullptr) {
+                    profile_->access(address, index, true);
+                }
+#endif
+                if (links_.exclusive && !write) {
+                    //The block moves up to the level that asked for it. That level has
+                    //already filled it clean, so the hierarchy passes the dirty bit on.
+                    if (storage_.isDirty(index, hit_way)) {
+                        links_.traffic->moved_up_dirty.push_back(address_no_offset << shift);
+                    }
+                    storage_.clearValidBit(index, hit_way);
+                    return;
+                }
+            }
+            //Reads and writes are mixed unpredictably, so mark the block dirty without a branch
+            storage_.setDirty(index)[hit_way >> 6] |= (unsigned long long)(write && write_back_) << (hit_way & 63);
+            if (write && !write_back_) {
+                if (access_type == 'W') {
+                    stats_.write_throughs++;
+                }
+                else {
+                    stats_.writebacks++;
+                }
+                sendDown(address, access_type);
+            }
+            //Tell the policy the block was just used
+            policy.onHit(index, hit_way, associativity);
+
+            if (prefetcher_ != nullptr && !insertion) {
+                prefetch_clock_++;
+                if (isPrefetched(index, hit_way)) {
+                    //First use of a prefetched block, which also keeps the prefetcher going
+                    stats_.useful_prefetches++;
+                    if (prefetch_clock_ - prefetched_at_[index * associativity + hit_way] <= (unsigned long long)prefetch_latency_) {
+                        stats_.late_prefetches++;
+                    }
+                    setPrefetchedBit(index, hit_way, false);
+                    prefetchAfter<POLICY, WAYS>(policy, address_no_offset, false);
+                }
+            }
+            return;
+        }
+    }
+
+    // 4. Handle a Miss
+    bool victim_dirty = false;
+    if (!insertion) {
+        stats_.misses++;
+#ifdef CACHESIM_PROFILE
+        if (profile_ != nullptr) {
+            profile_->access(address, index, false);
+        }
+#endif
+        if (classifier_ != nullptr) {
+            switch (shadow) {
+            case ShadowResult::FirstTouch: stats_.compulsory_misses++; break;
+            case ShadowResult::Miss: stats_.capacity_misses++; break;
+            case ShadowResult::Hit: stats_.conflict_misses++; break;
+            }
+        }
+
+        //A block found in the victim cache is swapped back in instead of fetched
+        if (victim_cache_ != nullptr && victim_cache_->take(address_no_offset, victim_dirty)) {
+            stats_.victim_hits++;
+        }
+        //An exclusive level is only filled by victims from above, and a no-write-allocate
+        //cache is not filled by writes
+        else if (links_.exclusive || (write && !write_allocate_)) {
+            if (write) {
+                stats_.write_throughs++;
+                sendDown(address, 'W');
+            }
+            else {
+                stats_.fetches++;
+                sendDown(address_no_offset << shift, 'R');
+            }
+            return;
+        }
+        else {
+            stats_.fetches++;
+            sendDown(address_no_offset << shift, 'R');
+        }
+        if (prefetcher_ != nullptr) {
+            prefetch_clock_++;
+            //Was the block pushed out by a prefetch?
+            unsigned long long* victims = polluted_.data() + index * associativity;
+            for (int i = 0; i < associativity; ++i) {
+                if (victims[i] == tag + 1) {
+                    stats_.pollution_misses++;
+                    victims[i] = 0;
+                    break;
+                }
+            }
+        }
+        if (write && !write_back_) {
+            stats_.write_throughs++;
+            sendDown(address, 'W');
+        }
+    }
+    else if (write && !write_back_) {
+        //A write-back from above goes on down, only an exclusive level keeps a copy
+        stats_.writebacks++;
+        sendDown(address, ACCESS_WRITEBACK);
+        if (!links_.exclusive) {
+            return;
+        }
+    }
+
+    // 5. Put the new block in, dirty if it was written here
+    fill<POLICY, WAYS>(policy, index, tag, (write && write_back_) || victim_dirty, false);
+
+    if (prefetcher_ != nullptr && !insertion) {
+        prefetchAfter<POLICY, WAYS>(policy, address_no_offset, true);
+    }
+}
+
+
+template <class POLICY, int WAYS>
+void Cache::prefetchAfter(POLICY& policy, unsigned long long block, bool miss) {
+    const int associativity = WAYS ? WAYS : storage_.associativity;
+
+    prefetch_candidates_.clear();
+    prefetcher_->train(block, miss, prefetch_candidates_);
+    for (unsigned long long candidate : prefetch_candidates_) {
+        unsigned long long address = candidate << geometry_.offset_bits;
+        unsigned long long index;
+        if (findWay(address, index) >= 0) {
+            continue; //Already cached
+        }
+        unsigned long long tag;
+        splitBlock(candidate, index, tag);
+
+        //Coming back in, so it can no longer be missed on because of a prefetch
+        unsigned long long* victims = polluted_.data() + index * associativity;
+        for (int i = 0; i < associativity; ++i) {
+            if (victims[i] == tag + 1) {
+                victims[i] = 0;
+            }
+        }
+
+        stats_.prefetches++;
+        stats_.fetches++;
+        sendDown(address, 'R');
+        fill<POLICY, WAYS>(policy, index, tag, false, true);
+    }
+}
+
+
+template <class POLICY, int WAYS>
+void Cache::fill(POLICY& policy, unsigned long long index, unsigned long long tag, bool dirty, bool prefetch) {
+    unsigned long long* set_tags = storage_.setTags(index);
+    const int associativity = WAYS ? WAYS : storage_.associativity;
+
+    //Try to find an "invalid" (empty) block
+    int free_way = storage_.findInvalidWay(index);
+    if (free_way >= 0) {
+        //Found an empty slot. This is a miss.
+        storage_.setValidBit(index, free_way);
+        storage_.setDirtyBit(index, free_way, dirty);
+        set_tags[free_way] = tag;
+        policy.onFill(index, free_way, associativity);
+        if (prefetcher_ != nullptr) {
+            setPrefetchedBit(index, free_way, prefetch);
+            prefetched_at_[index * associativity + free_way] = prefetch_clock_;
+        }
+        return;
+    }
+
+    // 6. If no invalid blocks, we must EVIC a block (the policy picks which)
+
+    int victim_way = policy.victim(index, associativity);
+#ifdef CACHESIM_PROFILE
+    if (profile_ != nullptr) {
+        profile_->evict(index, blockAddress(index, victim_way));
+    }
+#endif
+
+    //A dirty victim is written back, and the hierarchy may want to know what left the cache.
+    //With a victim cache only what that drops leaves.
+    if (victim_cache_ != nullptr) {
+        evictToVictimCache(index, victim_way);
+    }
+    else {
+        bool victim_dirty = storage_.isDirty(index, victim_way);
+        stats_.writebacks += victim_dirty;
+        if (links_.traffic != nullptr && (victim_dirty || links_.send_victims || links_.report_evictions)) {
+            sendEvicted(blockAddress(index, victim_way), victim_dirty);
+        }
+    }
+
+    if (prefetcher_ != nullptr) {
+        if (isPrefetched(index, victim_way)) {
+            stats_.useless_prefetches++;
+        }
+        if (prefetch) {
+            //Remember what the prefetch pushed out, the oldest such victim makes room
+            unsigned int& next = polluted_next_[index];
+            polluted_[index * associativity + next] = set_tags[victim_way] + 1;
+            next = (next + 1 == (unsigned int)associativity) ? 0 : next + 1;
+        }
+        setPrefetchedBit(index, victim_way, prefetch);
+        prefetched_at_[index * associativity + victim_way] = prefetch_clock_;
+    }
+
+    //Evict the victim block and replace it (it stays valid)
+    set_tags[victim_way] = tag; //With the new tag
+    storage_.setDirtyBit(index, victim_way, dirty);
+    policy.onFill(index, victim_way, associativity);
+}
+
+
+//Way w of a block lives in set skewed.set(block, w), so a lookup checks one block in each
+//of associativity different sets. The replacement candidates are those same blocks, and
+//the least recently used one of them is replaced: per-set policy state does not apply to
+//blocks of different sets, so every block keeps the access it was last used at instead.
+void Cache::accessSkewed(unsigned long long address, char access_type) {
+    const SkewedIndex& skewed = std::get<SkewedIndex>(indexes_);
+    const int associativity = storage_.associativity;
+    unsigned long long block = address >> geometry_.offset_bits;
+
+    const bool insertion = (access_type == ACCESS_EVICT || access_type == ACCESS_WRITEBACK);
+    const bool write = (access_type == 'W' || access_type == ACCESS_WRITEBACK);
+
+    ShadowResult shadow = ShadowResult::Hit;
+    if (classifier_ != nullptr && !insertion) {
+        shadow = classifier_->access(block);
+    }
+    skewed_clock_++;
+
+    //1. Look for the block in the set of every way, and pick the way to fill if it is not
+    //there: the first empty one, or else the least recently used
+    unsigned long long fill_set = 0;
+    int fill_way = -1;
+    bool fill_empty = false;
+    for (int way = 0; way < associativity; ++way) {
+        unsigned long long set = skewed.set(block, way);
+        if (!storage_.isValid(set, way)) {
+            if (!fill_empty) {
+                fill_set = set;
+                fill_way = way;
+                fill_empty = true;
+            }
+            continue;
+        }
+        if (storage_.tags[set * storage_.tag_stride + way] != block) {
+            if (!fill_empty && (fill_way < 0 || skewed_used_[set * associativity + way] < skewed_used_[fill_set * associativity + fill_way])) {
+                fill_set = set;
+                fill_way = way;
+            }
+            continue;
+        }
+
+        //2. A hit, handled as in accessDecoded
+        if (!insertion) {
+            stats_.hits++;
+            if (links_.exclusive && !write) {
+                if (storage_.isDirty(set, way)) {
+                    links_.traffic->moved_up_dirty.push_back(block << geometry_.offset_bits);
+                }
+                storage_.clearValidBit(set, way);
+                return;
+            }
+        }
+        if (write && write_back_) {
+            storage_.setDirtyBit(set, way, true);
+        }
+        if (write && !write_back_) {
+            if (access_type == 'W') {
+                stats_.write_throughs++;
+            }
+            else {
+                stats_.writebacks++;
+            }
+            sendDown(address, access_type);
+        }
+        skewed_used_[set * associativity + way] = skewed_clock_;
+        return;
+    }
+
+    //3. A miss
+    if (!insertion) {
+        stats_.misses++;
+        if (classifier_ != nullptr) {
+            switch (shadow) {
+            case ShadowResult::FirstTouch: stats_.compulsory_misses++; break;
+            case ShadowResult::Miss: stats_.capacity_misses++; break;
+            case ShadowResult::Hit: stats_.conflict_misses++; break;
+            }
+        }
+        if (links_.exclusive || (write && !write_allocate_)) {
+            if (write) {
+                stats_.write_throughs++;
+                sendDown(address, 'W');
+            }
+            else {
+                stats_.fetches++;
+                sendDown(block << geometry_.offset_bits, 'R');
+            }
+            return;
+        }
+        stats_.fetches++;
+        sendDown(block << geometry_.offset_bits, 'R');
+        if (write && !write_back_) {
+            stats_.write_throughs++;
+            sendDown(address, 'W');
+        }
+    }
+    else if (write && !write_back_) {
+        stats_.writebacks++;
+        sendDown(address, ACCESS_WRITEBACK);
+        if (!links_.exclusive) {
+            return;
+        }
+    }
+
+    //4. Put the new block in
+    if (!fill_empty) {
+        bool victim_dirty = storage_.isDirty(fill_set, fill_way);
+        stats_.writebacks += victim_dirty;
+        if (links_.traffic != nullptr && (victim_dirty || links_.send_victims || links_.report_evictions)) {
+            sendEvicted(blockAddress(fill_set, fill_way), victim_dirty);
+        }
+    }
+    storage_.tags[fill_set * storage_.tag_stride + fill_way] = block;
+    storage_.setValidBit(fill_set, fill_way);
+    storage_.setDirtyBit(fill_set, fill_way, write && write_back_);
+    skewed_used_[fill_set * associativity + fill_way] = skewed_clock_;
+}
+
+
+void Cache::accessBatchSkewed(const TraceRecord* records, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        accessSkewed(records[i].address, records[i].access_type);
+    }
+}
+
+
+void Cache::evictToVictimCache(unsigned long long index, int way) {
+    unsigned long long dropped;
+    bool dropped_dirty;
+    if (victim_cache_->insert(blockAddress(index, way) >> geometry_.offset_bits, storage_.isDirty(index, way), dropped, dropped_dirty) &&
+        dropped_dirty) {
+        stats_.writebacks++;
+        sendDown(dropped << geometry_.offset_bits, ACCESS_WRITEBACK);
+    }
+}
+
+
+void Cache::sendEvicted(unsigned long long address, bool dirty) {
+    if (dirty) {
+        sendDown(address, ACCESS_WRITEBACK);
+    }
+    else if (links_.send_victims) {
+        sendDown(address, ACCESS_EVICT);
+    }
+    if (links_.report_evictions) {
+        links_.traffic->evicted.push_back(address);
+    }
+}
+
+
+int Cache::findWay(unsigned long long address, unsigned long long& index) const {
+    if (index_function_ == IndexFunction::Skewed) {
+        //Every way has a set of its own, and the tag is the whole block number
+        unsigned long long block = address >> geometry_.offset_bits;
+        const SkewedIndex& skewed = std::get<SkewedIndex>(indexes_);
+        for (int way = 0; way < storage_.associativity; ++way) {
+            unsigned long long set = skewed.set(block, way);
+            if (storage_.isValid(set, way) && storage_.tags[set * storage_.tag_stride + way] == block) {
+                index = set;
+                return way;
+            }
+        }
+        return -1;
+    }
+
+    unsigned long long tag;
+    splitBlock(address >> geometry_.offset_bits, index, tag);
+
+    const unsigned long long* set_tags = storage_.tags + index * storage_.tag_stride;
+    const unsigned long long* set_valid = storage_.state.data() + index * storage_.valid_words * 2;
+    for (int base = 0; base < storage_.associativity; base += 64) {
+        int count = (storage_.associativity - base < 64) ? storage_.associativity - base : 64;
+        unsigned long long hit_ways = matchTags(set_tags + base, count, tag) & set_valid[base >> 6];
+        if (hit_ways != 0) {
+            return base + countTrailingZeros(hit_ways);
+        }
+    }
+    return -1;
+}
+
+
+const char* Cache::checkpointObstacle() const {
+    if (prefetcher_ != nullptr) {
+        return "a prefetcher";
+    }
+    if (classifier_ != nullptr) {
+        return "miss classification";
+    }
+#ifdef CACHESIM_PROFILE
+    if (profile_ != nullptr) {
+        return "a profile";
+    }
+#endif
+    if (index_function_ == IndexFunction::Skewed) {
+        return "a SKEWED index";
+    }
+    return nullptr;
+}
+
+
+std::vector<long long> Cache::checkpointShape() const {
+    std::vector<long long> shape = { geometry_.cache_size, geometry_.block_size, geometry_.associativity, (long long)policy_,
+        (long long)write_back_, (long long)write_allocate_, (victim_cache_ != nullptr) ? victim_cache_->blocks() : 0,
+        (long long)index_function_, (long long)std::get<HashMatrixIndex>(indexes_).bits() };
+    for (int bit = 0; bit < std::get<HashMatrixIndex>(indexes_).bits(); ++bit) {
+        shape.push_back((long long)std::get<HashMatrixIndex>(indexes_).mask(bit));
+    }
+    return shape;
+}
+
+
+void Cache::checkpoint(CheckpointFile& file) {
+    //1. Counters
+    long long* counters[] = { &stats_.hits, &stats_.misses, &stats_.fetches, &stats_.writebacks, &stats_.write_throughs,
+        &stats_.prefetches, &stats_.useful_prefetches, &stats_.late_prefetches, &stats_.useless_prefetches,
+        &stats_.pollution_misses, &stats_.compulsory_misses, &stats_.capacity_misses, &stats_.conflict_misses,
+        &stats_.victim_hits };
+    for (long long* counter : counters) {
+        file.value(*counter);
+    }
+
+    //2. Blocks: the tags of every set (padding included), the valid and dirty masks and,
+    //if the coherence layer made them, the shared masks
+    file.range(storage_.tags, (std::size_t)storage_.num_sets * storage_.tag_stride);
+    file.items(storage_.state);
+    bool shared = !storage_.shared.empty();
+    file.value(shared);
+    if (shared && storage_.shared.empty()) {
+        storage_.shared.assign((std::size_t)storage_.num_sets * storage_.valid_words, 0);
+    }
+    file.items(storage_.shared);
+
+    //3. Replacement and victim cache state
+    switch (policy_) {
+    case ReplacementPolicy::Lru: std::get<LruPolicy>(policies_).checkpoint(file); break;
+    case ReplacementPolicy::TreePlru: std::get<TreePlruPolicy>(policies_).checkpoint(file); break;
+    case ReplacementPolicy::Srrip: std::get<SrripPolicy>(policies_).checkpoint(file); break;
+    case ReplacementPolicy::Brrip: std::get<BrripPolicy>(policies_).checkpoint(file); break;
+    case ReplacementPolicy::Fifo: std::get<FifoPolicy>(policies_).checkpoint(file); break;
+    case ReplacementPolicy::Random: std::get<RandomPolicy>(policies_).checkpoint(file); break;
+    }
+    if (victim_cache_ != nullptr) {
+        victim_cache_->checkpoint(file);
+    }
+}
+
+
+bool Cache::saveCheckpoint(const std::string& filename, long long trace_offset) {
+    const char* obstacle = checkpointObstacle();
+    if (obstacle != nullptr) {
+        std::cerr << "Error: A cache with " << obstacle << " cannot be checkpointed." << std::endl;
+        return false;
+    }
+
+    //Written next to the old checkpoint and renamed over it, so being stopped while saving
+    //leaves the old one intact
+    std::string temporary = filename + ".tmp";
+    CheckpointFile file(temporary, true);
+    if (!file.isOpen()) {
+        std::cerr << "Error: Could not create " << temporary << std::endl;
+        return false;
+    }
+    for (char c : CHECKPOINT_MAGIC) {
+        file.value(c);
+    }
+    for (long long value : checkpointShape()) {
+        file.value(value);
+    }
+    file.value(trace_offset);
+    checkpoint(file);
+    if (!file.close()) {
+        std::cerr << "Error: Failed writing " << temporary << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    //rename does not replace an existing file everywhere
+    std::remove(filename.c_str());
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Error: Could not rename " << temporary << " to " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool Cache::restoreCheckpoint(const std::string& filename, long long& trace_offset) {
+    const char* obstacle = checkpointObstacle();
+    if (obstacle != nullptr) {
+        std::cerr << "Error: A cache with " << obstacle << " cannot be restored from a checkpoint." << std::endl;
+        return false;
+    }
+
+    CheckpointFile file(filename, false);
+    if (!file.isOpen()) {
+        std::cerr << "Error: Could not open checkpoint " << filename << std::endl;
+        return false;
+    }
+    bool magic = true;
+    for (char expected : CHECKPOINT_MAGIC) {
+        char c = 0;
+        file.value(c);
+        magic = magic && c == expected;
+    }
+    if (!file.good() || !magic) {
+        std::cerr << "Error: " << filename << " is not a checkpoint" << std::endl;
+        return false;
+    }
+    for (long long expected : checkpointShape()) {
+        long long value = 0;
+        file.value(value);
+        if (file.good() && value != expected) {
+            std::cerr << "Error: Checkpoint " << filename << " was taken of a cache with a different geometry, "
+                << "policies or victim cache" << std::endl;
+            return false;
+        }
+    }
+    file.value(trace_offset);
+    checkpoint(file);
+    if (!file.good()) {
+        std::cerr << "Error: Checkpoint " << filename << " is truncated or corrupt" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool Cache::invalidate(unsigned long long address, bool* dirty) {
+    unsigned long long index;
+    int way = findWay(address, index);
+    if (way < 0) {
+        return false;
+    }
+    if (dirty != nullptr) {
+        *dirty = storage_.isDirty(index, way);
+    }
+    storage_.clearValidBit(index, way);
+    return true;
+}
+
+
+BlockState Cache::blockState(unsigned long long address) const {
+    BlockState state;
+    unsigned long long index;
+    int way = findWay(address, index);
+    if (way >= 0) {
+        state.valid = true;
+        state.dirty = storage_.isDirty(index, way);
+        state.shared = storage_.isShared(index, way);
+    }
+    return state;
+}
+
+
+void Cache::setBlockState(unsigned long long address, bool dirty, bool shared) {
+    unsigned long long index;
+    int way = findWay(address, index);
+    if (way >= 0) {
+        storage_.setDirtyBit(index, way, dirty);
+        storage_.setSharedBit(index, way, shared);
+    }
+}
+
+
+template <class POLICY, int WAYS>
+void Cache::prefetchSet(const POLICY& policy, unsigned long long index) const {
+    const int associativity = WAYS ? WAYS : storage_.associativity;
+    const unsigned long long* set_tags = storage_.tags + index * storage_.tag_stride;
+    //Wider sets take more than one host line of tags, the scan reads them all
+    for (int way = 0; way < associativity && way < 64; way += 8) {
+        prefetchRead(set_tags + way);
+    }
+    prefetchRead(storage_.state.data() + index * storage_.valid_words * 2);
+    policy.prefetch(index, associativity);
+}
+
+
+//Runs a batch of decoded trace records through one engine instantiation
+template <class POLICY, class INDEX, int WAYS, int BLOCK_SIZE>
+void Cache::accessBatchFixed(const TraceRecord* records, std::size_t count) {
+    //Records decoded at a time, and how far ahead of the access being simulated the set
+    //(and the shadow table entry of the miss classification) is prefetched. By the time
+    //the access gets there the lines have had DISTANCE accesses' worth of time to arrive.
+    const std::size_t CHUNK = 256;
+    const std::size_t PREFETCH_DISTANCE = 8;
+
+    const POLICY& policy = std::get<POLICY>(policies_);
+    const int shift = BLOCK_SIZE ? log2Constant(BLOCK_SIZE) : geometry_.offset_bits;
+    const INDEX set_index = std::get<INDEX>(indexes_);
+
+    unsigned long long blocks[CHUNK];
+    unsigned long long indices[CHUNK];
+    unsigned long long tags[CHUNK];
+    for (std::size_t start = 0; start < count; start += CHUNK) {
+        const TraceRecord* chunk = records + start;
+        const std::size_t chunk_count = (count - start < CHUNK) ? count - start : CHUNK;
+
+        //1. Split every address of the chunk. There is nothing to wait for between records,
+        //so the compiler vectorizes this loop.
+        for (std::size_t i = 0; i < chunk_count; ++i) {
+            unsigned long long block = chunk[i].address >> shift;
+            blocks[i] = block;
+            set_index.split(block, indices[i], tags[i]);
+        }
+
+        //2. Start on the first sets, then keep PREFETCH_DISTANCE sets in flight
+        for (std::size_t i = 0; i < chunk_count && i < PREFETCH_DISTANCE; ++i) {
+            prefetchSet<POLICY, WAYS>(policy, indices[i]);
+            if (classifier_ != nullptr) {
+                classifier_->prefetch(blocks[i]);
+            }
+        }
+        for (std::size_t i = 0; i < chunk_count; ++i) {
+            if (i + PREFETCH_DISTANCE < chunk_count) {
+                prefetchSet<POLICY, WAYS>(policy, indices[i + PREFETCH_DISTANCE]);
+                if (classifier_ != nullptr) {
+                    classifier_->prefetch(blocks[i + PREFETCH_DISTANCE]);
+                }
+            }
+            accessDecoded<POLICY, WAYS, BLOCK_SIZE>(chunk[i].address, blocks[i], indices[i], tags[i], chunk[i].access_type);
+        }
+    }
+}
+
+
+template <class POLICY, class INDEX, int BLOCK_SIZE>
+bool Cache::selectEngineWays() {
+    switch (geometry_.associativity) {
+    case 1: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 1, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 1, BLOCK_SIZE>; return true;
+    case 2: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 2, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 2, BLOCK_SIZE>; return true;
+    case 4: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 4, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 4, BLOCK_SIZE>; return true;
+    case 8: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 8, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 8, BLOCK_SIZE>; return true;
+    case 16: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 16, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 16, BLOCK_SIZE>; return true;
+    case 32: access_fn_ = &Cache::accessFixed<POLICY, INDEX, 32, BLOCK_SIZE>; batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 32, BLOCK_SIZE>; return true;
+    default: return false;
+    }
+}
+
+template <class POLICY, class INDEX>
+void Cache::selectEngineIndex() {
+    //These are for last-level caches, which keep to 64B blocks: specializing the rest too
+    //would double the engines to compile for little use
+    specialized_ = (geometry_.block_size == 64) && selectEngineWays<POLICY, INDEX, 64>();
+    if (!specialized_) {
+        access_fn_ = &Cache::accessFixed<POLICY, INDEX, 0, 0>;
+        batch_fn_ = &Cache::accessBatchFixed<POLICY, INDEX, 0, 0>;
+    }
+}
+
+//Picks the specialized engine for this geometry, or the generic one if there is none.
+//The choice is made once, so the per-access code has no dispatch of its own.
+template <class POLICY>
+void Cache::selectEngineFor() {
+    std::get<POLICY>(policies_).init(geometry_.num_sets, geometry_.associativity);
+
+    switch (index_function_) {
+    case IndexFunction::XorFold: selectEngineIndex<POLICY, XorFoldIndex>(); return;
+    case IndexFunction::HashMatrix: selectEngineIndex<POLICY, HashMatrixIndex>(); return;
+    default: break;
+    }
+    if (!geometry_.powerOfTwoSets()) {
+        selectEngineIndex<POLICY, ModuloIndex>();
+        return;
+    }
+
+    switch (geometry_.block_size) {
+    case 32: specialized_ = selectEngineWays<POLICY, PowerOfTwoIndex, 32>(); break;
+    case 64: specialized_ = selectEngineWays<POLICY, PowerOfTwoIndex, 64>(); break;
+    case 128: specialized_ = selectEngineWays<POLICY, PowerOfTwoIndex, 128>(); break;
+    default: specialized_ = false; break;
+    }
+    if (!specialized_) {
+        access_fn_ = &Cache::accessFixed<POLICY, PowerOfTwoIndex, 0, 0>;
+        batch_fn_ = &Cache::accessBatchFixed<POLICY, PowerOfTwoIndex, 0, 0>;
+    }
+}
+
+void Cache::selectEngine() {
+    if (index_function_ == IndexFunction::Skewed) {
+        access_fn_ = &Cache::accessSkewed;
+        batch_fn_ = &Cache::accessBatchSkewed;
+        specialized_ = false;
+        return;
+    }
+    switch (policy_) {
+    case ReplacementPolicy::Lru: selectEngineFor<LruPolicy>(); break;
+    case ReplacementPolicy::TreePlru: selectEngineFor<TreePlruPolicy>(); break;
+    case ReplacementPolicy::Srrip: selectEngineFor<SrripPolicy>(); break;
+    case ReplacementPolicy::Brrip: selectEngineFor<BrripPolicy>(); break;
+    case ReplacementPolicy::Fifo: selectEngineFor<FifoPolicy>(); break;
+    case ReplacementPolicy::Random: selectEngineFor<RandomPolicy>(); break;
+    }
+}
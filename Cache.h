@@ -0,0 +1,389 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "CacheStorage.h"
+#include "Checkpoint.h"
+#include "MissClassifier.h"
+#include "Prefetcher.h"
+#include "Profile.h"
+#include "ReplacementPolicy.h"
+#include "SetIndex.h"
+#include "Trace.h"
+#include "VictimCache.h"
+
+//Shape of a cache, derived from size, block size and associativity
+struct CacheGeometry {
+    long long cache_size = 0; //Bytes
+    int block_size = 0; //Bytes
+    int associativity = 0;
+    int num_sets = 0; //Any number, see SetIndex.h
+    int offset_bits = 0; //To find a byte within a block
+    int index_bits = 0; //To find the set, 0 unless num_sets is a power of two (the set is then the block modulo num_sets)
+    int tag_bits = 0; //The rest of a 64-bit address
+
+    bool powerOfTwoSets() const { return (num_sets & (num_sets - 1)) == 0; }
+};
+
+//Works out the number of sets and the address bit fields. The block size must be a power
+//of two and the cache a whole number of sets.
+//Prints an error and returns false if the shape is impossible.
+bool computeGeometry(long long cache_size, int block_size, int associativity, CacheGeometry& geometry);
+
+//Checks that an index function (see SetIndex.h) works for this geometry and policy: the
+//hashed ones need a power-of-two number of sets, HASH_MATRIX one invertible mask per index
+//bit, and SKEWED the LRU policy.
+//Prints an error and returns false if it does not.
+bool checkIndexConfig(const IndexConfig& index, const CacheGeometry& geometry, ReplacementPolicy policy);
+
+
+//What a cache does with a write that hits
+enum class WritePolicy {
+    WriteBack, //Mark the block dirty, write it down when it is evicted
+    WriteThrough //Pass every write straight down, blocks are never dirty
+};
+
+//What a cache does with a write that misses
+enum class WriteMissPolicy {
+    WriteAllocate, //Fetch the block, then write it as on a hit
+    NoWriteAllocate //Only pass the write down
+};
+
+//Accept WRITE_BACK / WRITE_THROUGH and WRITE_ALLOCATE / NO_WRITE_ALLOCATE in any case.
+//Print an error and return false for anything else.
+bool parseWritePolicy(const std::string& name, WritePolicy& policy);
+bool parseWriteMissPolicy(const std::string& name, WriteMissPolicy& policy);
+
+const char* writePolicyName(WritePolicy policy);
+const char* writeMissPolicyName(WriteMissPolicy policy);
+
+//The trace carries no access sizes, so a write passed down counts as one 8-byte word
+const int WRITE_THROUGH_BYTES = 8;
+
+
+//Counters reported at the end of a run
+struct CacheStats {
+    long long hits = 0; //Of demand accesses ('R' and 'W')
+    long long misses = 0;
+    long long fetches = 0; //Blocks read from the next level
+    long long writebacks = 0; //Dirty blocks written to the next level
+    long long write_throughs = 0; //Writes passed to the next level (write-through, no-write-allocate)
+    long long prefetches = 0; //Blocks brought in by the prefetcher (also counted in fetches)
+    long long useful_prefetches = 0; //Prefetched blocks demanded before they were evicted
+    long long late_prefetches = 0; //Useful ones demanded within PREFETCH_LATENCY accesses of their prefetch
+    long long useless_prefetches = 0; //Prefetched blocks evicted without being demanded
+    long long pollution_misses = 0; //Misses to blocks a prefetch evicted not long before
+    long long compulsory_misses = 0; //3C classification of the misses, if enabled
+    long long capacity_misses = 0;
+    long long conflict_misses = 0;
+    long long victim_hits = 0; //Misses whose block was in the victim cache, if there is one
+
+    long long accesses() const { return hits + misses; }
+    double hitRate() const { return (accesses() == 0) ? 0.0 : (double)hits / accesses(); }
+
+    //Hit rate of the cache and its victim cache together
+    double combinedHitRate() const { return (accesses() == 0) ? 0.0 : (double)(hits + victim_hits) / accesses(); }
+
+    //Share of the prefetches that were used, and of the would-be misses they removed
+    double prefetchAccuracy() const { return (prefetches == 0) ? 0.0 : (double)useful_prefetches / prefetches; }
+    double prefetchCoverage() const {
+        return (useful_prefetches + misses == 0) ? 0.0 : (double)useful_prefetches / (useful_prefetches + misses);
+    }
+
+    //Bytes moved between this cache and the next level
+    long long trafficBytes(int block_size) const {
+        return (fetches + writebacks) * block_size + write_throughs * WRITE_THROUGH_BYTES;
+    }
+
+    void add(const CacheStats& other) {
+        hits += other.hits;
+        misses += other.misses;
+        fetches += other.fetches;
+        writebacks += other.writebacks;
+        write_throughs += other.write_throughs;
+        prefetches += other.prefetches;
+        useful_prefetches += other.useful_prefetches;
+        late_prefetches += other.late_prefetches;
+        useless_prefetches += other.useless_prefetches;
+        pollution_misses += other.pollution_misses;
+        compulsory_misses += other.compulsory_misses;
+        capacity_misses += other.capacity_misses;
+        conflict_misses += other.conflict_misses;
+        victim_hits += other.victim_hits;
+    }
+};
+
+
+//Access types a level of a hierarchy sends below it, besides the trace's 'R' and 'W':
+//a clean block evicted from the level above moving into an exclusive level, and a dirty
+//block written back from the level above. Neither is a demand access.
+const char ACCESS_EVICT = 'E';
+const char ACCESS_WRITEBACK = 'B';
+
+//What a cache sends to the next level down, in the order it happened
+struct CacheTraffic {
+    std::vector<TraceRecord> down; //Fetches, writes, write-backs and, if enabled, victims
+    std::vector<unsigned long long> evicted; //Evicted blocks, if enabled (for back-invalidation)
+    std::vector<unsigned long long> moved_up_dirty; //Dirty blocks an exclusive level moved up
+
+    void clear() {
+        down.clear();
+        evicted.clear();
+        moved_up_dirty.clear();
+    }
+};
+
+//How a cache takes part in a hierarchy (see Hierarchy.h). The defaults are a standalone cache.
+struct CacheLinks {
+    CacheTraffic* traffic = nullptr; //Where misses go, nullptr to only count them
+    bool exclusive = false; //Holds only blocks evicted from above: ACCESS_EVICT fills, a hit moves the block up
+    bool send_victims = false; //Pass every clean evicted block down as ACCESS_EVICT
+    bool report_evictions = false; //List evicted blocks in traffic->evicted
+};
+
+
+//Flags of one cached block, for protocols layered on top of the cache (see Coherence.h)
+struct BlockState {
+    bool valid = false;
+    bool dirty = false;
+    bool shared = false; //Only ever set through setBlockState
+};
+
+
+//One simulated cache. Every instance owns its geometry, storage, counters and replacement
+//state, so any number of caches can run side by side in one process.
+class Cache {
+public:
+    explicit Cache(const CacheGeometry& geometry, ReplacementPolicy policy = ReplacementPolicy::Lru,
+        WritePolicy write_policy = WritePolicy::WriteBack, WriteMissPolicy write_miss_policy = WriteMissPolicy::WriteAllocate);
+
+    //Simulates one access. access_type is 'R', 'W', ACCESS_EVICT or ACCESS_WRITEBACK.
+    void access(unsigned long long address, char access_type) {
+        (this->*access_fn_)(address, access_type);
+    }
+
+    //Simulates a batch of decoded trace records. The set and tag of every record are worked
+    //out up front, and the sets of the records a few places ahead are prefetched, so the
+    //host cache misses on the tag and replacement state of big caches overlap.
+    void access(const TraceRecord* records, std::size_t count) {
+        (this->*batch_fn_)(records, count);
+    }
+
+    const CacheStats& stats() const { return stats_; }
+    const CacheGeometry& geometry() const { return geometry_; }
+    ReplacementPolicy policy() const { return policy_; }
+    WritePolicy writePolicy() const { return write_back_ ? WritePolicy::WriteBack : WritePolicy::WriteThrough; }
+    WriteMissPolicy writeMissPolicy() const { return write_allocate_ ? WriteMissPolicy::WriteAllocate : WriteMissPolicy::NoWriteAllocate; }
+
+    //True if the geometry has a compile-time specialized engine (see Cache.cpp)
+    bool isSpecialized() const { return specialized_; }
+
+    void link(const CacheLinks& links) { links_ = links; }
+
+    //Picks the set index function, which must have passed checkIndexConfig. Call before the
+    //first access. A SKEWED cache has an engine of its own, without prefetching, a victim
+    //cache, a profile or checkpoints.
+    void setIndexFunction(const IndexConfig& index);
+
+    IndexFunction indexFunction() const { return index_function_; }
+
+    //Runs a prefetcher on this cache's demand misses (see Prefetcher.h). Prefetched blocks
+    //are filled like misses and sent down as 'R' fetches. A miss to a block that a prefetch
+    //evicted while it was among the last `associativity` such victims of its set counts as
+    //a pollution miss. Not for exclusive levels.
+    void enablePrefetching(const PrefetchConfig& config);
+
+    //Splits the misses into compulsory, capacity and conflict ones (see MissClassifier.h)
+    void enableMissClassification();
+
+    //Puts a victim cache of `blocks` blocks (1 to MAX_VICTIM_CACHE_BLOCKS) behind the cache,
+    //see VictimCache.h. Its hits still count as misses of the cache, and as victim_hits.
+    //For standalone caches without a prefetcher only: invalidate and blockState do not
+    //look at it.
+    void enableVictimCache(int blocks);
+
+#ifdef CACHESIM_PROFILE
+    //Profiles the sets of this cache (see Profile.h), listing the top_evicted most evicted
+    //blocks. Demand accesses only.
+    void enableProfile(int top_evicted);
+
+    //nullptr unless enabled
+    const CacheProfile* profile() const { return profile_.get(); }
+#endif
+
+    //Writes the whole state of the cache, and trace_offset (the trace records simulated so
+    //far), to filename (see Checkpoint.h). The file is replaced only once the new one is
+    //complete. Not for caches with a prefetcher, miss classification or a profile.
+    //Prints an error and returns false on failure.
+    bool saveCheckpoint(const std::string& filename, long long trace_offset);
+
+    //Restores a checkpoint of a cache with the same geometry, policies and victim cache
+    //size, and sets trace_offset. Prints an error and returns false if it cannot be used.
+    bool restoreCheckpoint(const std::string& filename, long long& trace_offset);
+
+    //Zeroes the counters (and the profile, if any) and keeps the contents, for measuring
+    //a warm cache
+    void resetStats();
+
+    //Drops the block holding address if it is cached. Returns true if it was, and sets
+    //*dirty (if given) to whether the dropped block still had to be written back.
+    bool invalidate(unsigned long long address, bool* dirty = nullptr);
+
+    //Flags of the block holding address. Does not count as an access.
+    BlockState blockState(unsigned long long address) const;
+
+    //Sets the flags of the block holding address, if it is cached
+    void setBlockState(unsigned long long address, bool dirty, bool shared);
+
+private:
+    typedef void (Cache::*AccessFunction)(unsigned long long address, char access_type);
+    typedef void (Cache::*BatchFunction)(const TraceRecord* records, std::size_t count);
+
+    template <class POLICY, class INDEX, int WAYS, int BLOCK_SIZE>
+    void accessFixed(unsigned long long address, char access_type);
+
+    //accessFixed once address has been split into block (address without the offset),
+    //set index and tag
+    template <class POLICY, int WAYS, int BLOCK_SIZE>
+    void accessDecoded(unsigned long long address, unsigned long long block, unsigned long long index,
+        unsigned long long tag, char access_type);
+
+    template <class POLICY, class INDEX, int WAYS, int BLOCK_SIZE>
+    void accessBatchFixed(const TraceRecord* records, std::size_t count);
+
+    //The engine of a SKEWED cache, for any associativity and LRU only
+    void accessSkewed(unsigned long long address, char access_type);
+
+    void accessBatchSkewed(const TraceRecord* records, std::size_t count);
+
+    template <class POLICY, class INDEX, int BLOCK_SIZE>
+    bool selectEngineWays();
+
+    //The engines of an index function other than a power-of-two MODULO
+    template <class POLICY, class INDEX>
+    void selectEngineIndex();
+
+    template <class POLICY>
+    void selectEngineFor();
+
+    void selectEngine();
+
+    //Starts loading the tags, valid and dirty masks and replacement state of set index
+    template <class POLICY, int WAYS>
+    void prefetchSet(const POLICY& policy, unsigned long long index) const;
+
+    //Fills way of set index with tag, writing back or passing down what it held
+    template <class POLICY, int WAYS>
+    void fill(POLICY& policy, unsigned long long index, unsigned long long tag, bool dirty, bool prefetch);
+
+    //Asks the prefetcher about a demand access to block and fills what it names
+    template <class POLICY, int WAYS>
+    void prefetchAfter(POLICY& policy, unsigned long long block, bool miss);
+
+    bool isPrefetched(unsigned long long index, int way) const {
+        return (prefetched_[index * storage_.valid_words + (way >> 6)] >> (way & 63)) & 1;
+    }
+
+    void setPrefetchedBit(unsigned long long index, int way, bool prefetched) {
+        unsigned long long& word = prefetched_[index * storage_.valid_words + (way >> 6)];
+        word = (word & ~(1ULL << (way & 63))) | ((unsigned long long)prefetched << (way & 63));
+    }
+
+    //Saves or restores everything but the header of a checkpoint
+    void checkpoint(CheckpointFile& file);
+
+    //Header values of a checkpoint the restored cache has to match
+    std::vector<long long> checkpointShape() const;
+
+    //Why this cache cannot be checkpointed, nullptr if it can
+    const char* checkpointObstacle() const;
+
+    //Moves the block in way of set index to the victim cache, writing back what that drops
+    void evictToVictimCache(unsigned long long index, int way);
+
+
+    void sendDown(unsigned long long address, char access_type) {
+        if (links_.traffic != nullptr) {
+            TraceRecord record = { address, access_type, 0 };
+            links_.traffic->down.push_back(record);
+        }
+    }
+
+    //Writes back or passes down the block at address as it leaves the cache, as the links
+    //ask. Out of line, so the fill of a standalone cache stays small.
+    void sendEvicted(unsigned long long address, bool dirty);
+
+    //Set of address and the way holding it, or -1 if it is not cached
+    int findWay(unsigned long long address, unsigned long long& index) const;
+
+    //Set index and tag of a block number, outside the engines. Not for SKEWED caches, whose
+    //blocks have a set per way.
+    void splitBlock(unsigned long long block, unsigned long long& index, unsigned long long& tag) const {
+        switch (index_function_) {
+        case IndexFunction::XorFold: std::get<XorFoldIndex>(indexes_).split(block, index, tag); return;
+        case IndexFunction::HashMatrix: std::get<HashMatrixIndex>(indexes_).split(block, index, tag); return;
+        default: break;
+        }
+        if (geometry_.powerOfTwoSets()) {
+            std::get<PowerOfTwoIndex>(indexes_).split(block, index, tag);
+        }
+        else {
+            std::get<ModuloIndex>(indexes_).split(block, index, tag);
+        }
+    }
+
+    //Address of the first byte of the block in way of set index
+    unsigned long long blockAddress(unsigned long long index, int way) const {
+        unsigned long long tag = storage_.tags[index * storage_.tag_stride + way];
+        unsigned long long block;
+        switch (index_function_) {
+        case IndexFunction::XorFold: block = std::get<XorFoldIndex>(indexes_).join(tag, index); break;
+        case IndexFunction::HashMatrix: block = std::get<HashMatrixIndex>(indexes_).join(tag, index); break;
+        case IndexFunction::Skewed: block = tag; break; //The whole block number is the tag
+        default:
+            block = geometry_.powerOfTwoSets() ? std::get<PowerOfTwoIndex>(indexes_).join(tag, index)
+                : std::get<ModuloIndex>(indexes_).join(tag, index);
+            break;
+        }
+        return block << geometry_.offset_bits;
+    }
+
+    CacheGeometry geometry_;
+    CacheStorage storage_;
+    CacheStats stats_;
+    ReplacementPolicy policy_;
+    CacheLinks links_;
+    bool write_back_;
+    bool write_allocate_;
+
+    //Prefetching state, empty unless enablePrefetching was called
+    std::unique_ptr<Prefetcher> prefetcher_;
+    int prefetch_latency_;
+    unsigned long long prefetch_clock_; //Demand accesses so far
+    std::vector<unsigned long long> prefetched_; //Per set valid_words masks: prefetched, not demanded yet
+    std::vector<unsigned long long> prefetched_at_; //Per block: prefetch_clock_ at its prefetch
+    std::vector<unsigned long long> polluted_; //Per set `associativity` tags + 1 of prefetch victims, 0 = none
+    std::vector<unsigned int> polluted_next_; //Per set: next polluted_ slot to overwrite
+    std::vector<unsigned long long> prefetch_candidates_;
+
+    std::unique_ptr<MissClassifier> classifier_; //nullptr unless enabled
+    std::unique_ptr<VictimCache> victim_cache_;
+#ifdef CACHESIM_PROFILE
+    std::unique_ptr<CacheProfile> profile_;
+#endif
+    //One slot per policy, only the selected one is initialized
+    std::tuple<LruPolicy, TreePlruPolicy, SrripPolicy, BrripPolicy, FifoPolicy, RandomPolicy> policies_;
+    //The index functions. MODULO sets up the first two, the others only their own.
+    IndexFunction index_function_;
+    std::tuple<PowerOfTwoIndex, ModuloIndex, XorFoldIndex, HashMatrixIndex, SkewedIndex> indexes_;
+    unsigned long long skewed_clock_; //SKEWED only: accesses so far, and per block the one of its last use
+    std::vector<unsigned long long> skewed_used_;
+
+    AccessFunction access_fn_;
+    BatchFunction batch_fn_;
+    bool specialized_;
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Bits.h"
+
+
+//Flat structure-of-arrays storage for a set-associative cache.
+//
+//All tags live in one allocation, set after set, laid out so that no set straddles a
+//64 byte boundary: the tag scan of an 8-way set touches exactly one host cache line.
+//Valid and dirty bits are packed into 64-bit masks per group of 64 ways, the dirty masks
+//right after the valid ones so both sit in the same host cache line. Caches kept coherent
+//(see Coherence.h) also get a shared mask per 64 ways, allocated on first use and kept
+//out of the hot state since only the coherence layer reads it. The replacement state
+//belongs to the policy (see ReplacementPolicy.h), so the hit check never has to pull it in.
+struct CacheStorage {
+    int num_sets = 0;
+    int associativity = 0;
+    int tag_stride = 0; //Distance between two sets in tags, in elements
+    int valid_words = 0; //Valid mask words per set, and as many dirty mask words
+
+    CacheStorage() = default;
+
+    CacheStorage(int sets, int ways) { init(sets, ways); }
+
+    //tags points into tag_memory, so copying would leave it aliasing the original.
+    //Moving is fine, a moved vector keeps its buffer.
+    CacheStorage(const CacheStorage&) = delete;
+    CacheStorage& operator=(const CacheStorage&) = delete;
+    CacheStorage(CacheStorage&&) = default;
+    CacheStorage& operator=(CacheStorage&&) = default;
+
+    void init(int sets, int ways) {
+        num_sets = sets;
+        associativity = ways;
+        //Pad each set so it never straddles a host cache line (8 tags per line): small sets
+        //round up to a power of two, larger ones to a whole number of lines
+        tag_stride = 1;
+        while (tag_stride < ways && tag_stride < 8) {
+            tag_stride *= 2;
+        }
+        if (ways > 8) {
+            tag_stride = (ways + 7) & ~7;
+        }
+        valid_words = (ways + 63) / 64;
+
+        //Over-allocate by one line so the first set can be aligned
+        tag_memory.assign((std::size_t)num_sets * tag_stride + 8, 0);
+        std::size_t misalignment = ((std::size_t)tag_memory.data() / sizeof(unsigned long long)) & 7;
+        tags = tag_memory.data() + ((8 - misalignment) & 7);
+
+        state.assign((std::size_t)num_sets * valid_words * 2, 0);
+    }
+
+    unsigned long long* setTags(unsigned long long index) {
+        return tags + index * tag_stride;
+    }
+
+    unsigned long long* setValid(unsigned long long index) {
+        return state.data() + index * valid_words * 2;
+    }
+
+    unsigned long long* setDirty(unsigned long long index) {
+        return setValid(index) + valid_words;
+    }
+
+    bool isValid(unsigned long long index, int way) const {
+        return (state[index * valid_words * 2 + (way >> 6)] >> (way & 63)) & 1;
+    }
+
+    void setValidBit(unsigned long long index, int way) {
+        state[index * valid_words * 2 + (way >> 6)] |= 1ULL << (way & 63);
+    }
+
+    //Also clears the dirty bit
+    void clearValidBit(unsigned long long index, int way) {
+        unsigned long long* set_state = setValid(index);
+        set_state[way >> 6] &= ~(1ULL << (way & 63));
+        set_state[valid_words + (way >> 6)] &= ~(1ULL << (way & 63));
+    }
+
+    bool isDirty(unsigned long long index, int way) const {
+        return (state[index * valid_words * 2 + valid_words + (way >> 6)] >> (way & 63)) & 1;
+    }
+
+    void setDirtyBit(unsigned long long index, int way, bool dirty) {
+        unsigned long long& word = setDirty(index)[way >> 6];
+        word = (word & ~(1ULL << (way & 63))) | ((unsigned long long)dirty << (way & 63));
+    }
+
+    bool isShared(unsigned long long index, int way) const {
+        return !shared.empty() && ((shared[index * valid_words + (way >> 6)] >> (way & 63)) & 1);
+    }
+
+    void setSharedBit(unsigned long long index, int way, bool is_shared) {
+        if (shared.empty()) {
+            shared.assign((std::size_t)num_sets * valid_words, 0);
+        }
+        unsigned long long& word = shared[index * valid_words + (way >> 6)];
+        word = (word & ~(1ULL << (way & 63))) | ((unsigned long long)is_shared << (way & 63));
+    }
+
+    //First way of the set without a valid block, or -1 if the set is full
+    int findInvalidWay(unsigned long long index) const {
+        const unsigned long long* words = state.data() + index * valid_words * 2;
+        for (int w = 0; w < valid_words; ++w) {
+            unsigned long long free_ways = ~words[w];
+            if (w == valid_words - 1 && (associativity & 63) != 0) {
+                free_ways &= (1ULL << (associativity & 63)) - 1;
+            }
+            if (free_ways != 0) {
+                return w * 64 + countTrailingZeros(free_ways);
+            }
+        }
+        return -1;
+    }
+
+    unsigned long long* tags = nullptr; //Aligned view into tag_memory
+    std::vector<unsigned long long> tag_memory;
+    std::vector<unsigned long long> state; //Per set: valid_words valid masks, then valid_words dirty masks
+    std::vector<unsigned long long> shared; //Per set: valid_words shared masks, empty until first set
+};
@@ -0,0 +1,76 @@
+#include "Checkpoint.h"
+
+#include <iostream>
+
+#include "Bits.h"
+#include "Config.h"
+
+bool parseResumeMode(const std::string& name, ResumeMode& mode) {
+    std::string upper = toUpper(name);
+    const ResumeMode all[] = { ResumeMode::Continue, ResumeMode::Warm };
+    for (ResumeMode candidate : all) {
+        if (upper == resumeModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported resume mode " << name << " (expected CONTINUE or WARM)" << std::endl;
+    return false;
+}
+
+
+const char* resumeModeName(ResumeMode mode) {
+    switch (mode) {
+    case ResumeMode::Continue: return "CONTINUE";
+    case ResumeMode::Warm: return "WARM";
+    }
+    return "unknown";
+}
+
+
+CheckpointFile::CheckpointFile(const std::string& filename, bool saving)
+    : saving_(saving), good_(true), remaining_(0) {
+    file_.open(filename, (saving ? std::ios::out | std::ios::trunc : std::ios::in) | std::ios::binary);
+    if (!file_.is_open()) {
+        good_ = false;
+        return;
+    }
+    if (!saving) {
+        file_.seekg(0, std::ios::end);
+        remaining_ = (unsigned long long)file_.tellg();
+        file_.seekg(0, std::ios::beg);
+    }
+}
+
+
+void CheckpointFile::bytes(unsigned long long* bits, std::size_t size) {
+    if (!good_) {
+        return;
+    }
+    unsigned char buffer[8];
+    if (saving_) {
+        storeLittleEndian64(buffer, *bits);
+        file_.write((const char*)buffer, (std::streamsize)size);
+        good_ = !file_.fail();
+        return;
+    }
+
+    if (remaining_ < size) {
+        good_ = false;
+        return;
+    }
+    unsigned char padded[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    file_.read((char*)padded, (std::streamsize)size);
+    good_ = !file_.fail();
+    remaining_ -= size;
+    *bits = loadLittleEndian64(padded);
+}
+
+
+bool CheckpointFile::close() {
+    if (saving_ && file_.is_open()) {
+        file_.close();
+        good_ = good_ && !file_.fail();
+    }
+    return good_;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+//Checkpoints of a cache.
+//
+//A checkpoint holds everything a Cache needs to carry on exactly where it stopped: the
+//tags and block flags, the replacement state, the counters and the victim cache, plus how
+//many trace records had been simulated. It lets a long run resume after the machine goes
+//away, and a cache warmed once on a prefix trace be reused by many measurement runs.
+//
+//File layout (all integers little-endian):
+//  8 bytes  magic "CSCHKPT2"
+//  8 bytes each: cache size, block size, associativity, replacement policy, write policy,
+//           write miss policy, victim cache blocks, index function, number of hash
+//           masks, the hash masks, trace records simulated
+//  then the state of the cache, see Cache::checkpoint
+//
+//Every piece of state is written and read by the same checkpoint(CheckpointFile&)
+//function, so saving and restoring cannot drift apart.
+
+class CheckpointFile {
+public:
+    //saving: true to write filename, false to read it
+    CheckpointFile(const std::string& filename, bool saving);
+
+    bool isOpen() const { return file_.is_open(); }
+    bool saving() const { return saving_; }
+
+    //False once anything failed: the file could not be written, or it ended early or
+    //holds a size that does not match
+    bool good() const { return good_; }
+
+    //Saves or restores one integer (or bool). Once the file is bad, restoring leaves it as is.
+    template <class T>
+    void value(T& value) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Checkpoints hold integers");
+        unsigned long long bits = (unsigned long long)value;
+        bytes(&bits, sizeof(T));
+        if (!saving_ && good_) {
+            value = (T)bits;
+        }
+    }
+
+    //Saves or restores count integers at data. The count is not stored: the cache being
+    //restored already has the geometry of the one that was saved.
+    template <class T>
+    void range(T* data, std::size_t count) {
+        for (std::size_t i = 0; i < count && good_; ++i) {
+            value(data[i]);
+        }
+    }
+
+    //Saves or restores a vector with its size. The vector being restored must already have
+    //that size, anything else means the file does not belong to this cache.
+    template <class T>
+    void items(std::vector<T>& vector) {
+        unsigned long long size = vector.size();
+        value(size);
+        if (!saving_ && size != vector.size()) {
+            good_ = false;
+        }
+        range(vector.data(), vector.size());
+    }
+
+    //Flushes a file being saved. Returns good().
+    bool close();
+
+private:
+    //Writes or reads the low `size` bytes of *bits, little-endian
+    void bytes(unsigned long long* bits, std::size_t size);
+
+    std::fstream file_;
+    bool saving_;
+    bool good_;
+    unsigned long long remaining_; //Bytes left to read when restoring
+};
+
+const char CHECKPOINT_MAGIC[8] = { 'C', 'S', 'C', 'H', 'K', 'P', 'T', '2' };
+
+
+//What a run restored from a checkpoint does with the trace and the counters
+enum class ResumeMode {
+    Continue, //Skip the records the checkpoint had simulated and keep counting
+    Warm //Start the trace from the beginning with zeroed counters, keeping only the contents
+};
+
+//Accepts CONTINUE and WARM in any case.
+//Prints an error and returns false for anything else.
+bool parseResumeMode(const std::string& name, ResumeMode& mode);
+
+const char* resumeModeName(ResumeMode mode);
@@ -0,0 +1,265 @@
+#include "Coherence.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "Config.h"
+
+bool parseCoherenceProtocol(const std::string& name, CoherenceProtocol& protocol) {
+    std::string upper = toUpper(name);
+
+    const CoherenceProtocol all[] = { CoherenceProtocol::Mesi, CoherenceProtocol::Moesi };
+    for (CoherenceProtocol candidate : all) {
+        if (upper == coherenceProtocolName(candidate)) {
+            protocol = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported coherence protocol " << name << " (expected MESI or MOESI)" << std::endl;
+    return false;
+}
+
+
+const char* coherenceProtocolName(CoherenceProtocol protocol) {
+    switch (protocol) {
+    case CoherenceProtocol::Mesi: return "MESI";
+    case CoherenceProtocol::Moesi: return "MOESI";
+    }
+    return "unknown";
+}
+
+
+bool checkCoherentLevels(const std::vector<LevelConfig>& levels) {
+    if (levels.size() > 2) {
+        std::cerr << "Error: With several cores, LEVELS can be at most 2 (private L1s and a shared L2)." << std::endl;
+        return false;
+    }
+    const LevelConfig& l1 = levels.front();
+    if (l1.write_policy != WritePolicy::WriteBack || l1.write_miss_policy != WriteMissPolicy::WriteAllocate) {
+        std::cerr << "Error: Coherent L1s must be WRITE_BACK and WRITE_ALLOCATE." << std::endl;
+        return false;
+    }
+    if (levels.size() == 2 && levels[1].inclusion == Inclusion::Exclusive) {
+        std::cerr << "Error: The shared L2 cannot be EXCLUSIVE with several cores." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+CoherentSystem::CoherentSystem(const std::vector<LevelConfig>& levels, int cores, CoherenceProtocol protocol)
+    : protocol_(protocol), l1_block_size_(levels[0].geometry.block_size), l1_traffic_(cores), core_stats_(cores),
+      invalidated_(cores) {
+    const LevelConfig& l1 = levels[0];
+    l1s_.reserve(cores);
+    for (int core = 0; core < cores; ++core) {
+        l1s_.emplace_back(l1.geometry, l1.policy, l1.write_policy, l1.write_miss_policy);
+        l1s_[core].setIndexFunction(l1.index);
+        CacheLinks links;
+        links.traffic = &l1_traffic_[core];
+        l1s_[core].link(links);
+    }
+
+    if (levels.size() > 1) {
+        const LevelConfig& llc = levels[1];
+        llc_.emplace_back(llc.geometry, llc.policy, llc.write_policy, llc.write_miss_policy);
+        llc_[0].setIndexFunction(llc.index);
+        CacheLinks links;
+        links.traffic = &llc_traffic_;
+        links.report_evictions = (llc.inclusion == Inclusion::Inclusive);
+        llc_[0].link(links);
+    }
+}
+
+
+void CoherentSystem::access(const TraceRecord* records, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (records[i].core >= l1s_.size()) {
+            throw std::out_of_range("Core ID " + std::to_string(records[i].core) + " in the trace, but CORES is " +
+                std::to_string(l1s_.size()));
+        }
+        accessCore(records[i].core, records[i].address, records[i].access_type == 'W');
+    }
+}
+
+
+void CoherentSystem::accessCore(int core, unsigned long long address, bool write) {
+    Cache& mine = l1s_[core];
+    BlockState state = mine.blockState(address);
+
+    //1. Hits: only a write to a shared (S or O) block needs the bus
+    if (state.valid) {
+        if (write && state.shared) {
+            core_stats_[core].upgrades++;
+            bus_.upgrades++;
+            invalidateOthers(core, address);
+        }
+        mine.access(address, write ? 'W' : 'R');
+        if (write) {
+            mine.setBlockState(address, true, false); //M
+        }
+        return;
+    }
+
+    //2. Misses: snoop the other L1s for a copy
+    unsigned long long block = address & ~(unsigned long long)(l1_block_size_ - 1);
+    bool supplied = false; //A dirty copy elsewhere provides the data instead of the LLC
+    bool others = false;
+    if (write) {
+        bus_.read_exclusives++;
+        supplied = invalidateOthers(core, address);
+    }
+    else {
+        bus_.reads++;
+        for (int other = 0; other < (int)l1s_.size(); ++other) {
+            if (other == core) {
+                continue;
+            }
+            BlockState copy = l1s_[other].blockState(address);
+            if (!copy.valid) {
+                continue;
+            }
+            others = true;
+            if (copy.dirty) {
+                supplied = true;
+                core_stats_[other].transfers++;
+                if (protocol_ == CoherenceProtocol::Moesi) {
+                    l1s_[other].setBlockState(address, true, true); //M or O -> O
+                    continue;
+                }
+                //MESI has no owner, the LLC gets the dirty data
+                bus_.flushes++;
+                TraceRecord flush = { block, ACCESS_WRITEBACK, 0 };
+                sendToLlc(flush);
+            }
+            l1s_[other].setBlockState(address, false, true); //M or E -> S
+        }
+    }
+    if (invalidated_[core].erase(block) > 0) {
+        core_stats_[core].coherence_misses++;
+    }
+
+    //3. Fill the L1. Its fetch goes to the LLC unless another core supplied the block, and
+    //a dirty victim is written back either way.
+    l1_traffic_[core].clear();
+    mine.access(address, write ? 'W' : 'R');
+    for (const TraceRecord& record : l1_traffic_[core].down) {
+        if (record.access_type == 'R' && supplied) {
+            continue;
+        }
+        sendToLlc(record);
+    }
+    mine.setBlockState(address, write, !write && others); //M, S or E
+}
+
+
+bool CoherentSystem::invalidateOthers(int core, unsigned long long address) {
+    unsigned long long block = address & ~(unsigned long long)(l1_block_size_ - 1);
+    bool dirty_copy = false;
+    for (int other = 0; other < (int)l1s_.size(); ++other) {
+        bool dirty = false;
+        if (other != core && l1s_[other].invalidate(address, &dirty)) {
+            core_stats_[other].invalidations++;
+            invalidated_[other].insert(block);
+            if (dirty) {
+                //The writer takes over the dirty data, nothing is written back
+                core_stats_[other].transfers++;
+                dirty_copy = true;
+            }
+        }
+    }
+    return dirty_copy;
+}
+
+
+void CoherentSystem::sendToLlc(const TraceRecord& record) {
+    if (llc_.empty()) {
+        sendToMemory(record, l1_block_size_);
+        return;
+    }
+
+    Cache& llc = llc_[0];
+    llc_traffic_.clear();
+    llc.access(record.address, record.access_type);
+    for (const TraceRecord& down : llc_traffic_.down) {
+        sendToMemory(down, llc.geometry().block_size);
+    }
+
+    //An inclusive LLC takes every block it evicts out of the L1s too
+    for (unsigned long long evicted : llc_traffic_.evicted) {
+        for (unsigned long long address = evicted; address < evicted + llc.geometry().block_size; address += l1_block_size_) {
+            for (Cache& l1 : l1s_) {
+                bool dirty = false;
+                if (l1.invalidate(address, &dirty)) {
+                    bus_.back_invalidations++;
+                    if (dirty) {
+                        bus_.memory_writebacks++;
+                        bus_.memory_bytes += l1_block_size_;
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void CoherentSystem::sendToMemory(const TraceRecord& record, int block_size) {
+    if (record.access_type == ACCESS_WRITEBACK) {
+        bus_.memory_writebacks++;
+        bus_.memory_bytes += block_size;
+    }
+    else if (record.access_type == 'W') {
+        bus_.memory_bytes += WRITE_THROUGH_BYTES;
+    }
+    else {
+        bus_.memory_reads++;
+        bus_.memory_bytes += block_size;
+    }
+}
+
+
+void printCoherenceResults(const CoherentSystem& system, const std::vector<LevelConfig>& levels) {
+    std::cout << "\n--- Multi-Core Results (" << coherenceProtocolName(system.protocol()) << ") ---" << std::endl;
+    std::cout << std::left << std::setw(7) << "Cache" << std::setw(14) << "Accesses" << std::setw(14) << "Hits"
+        << std::setw(14) << "Misses" << std::setw(11) << "Hit Rate" << std::setw(19) << "Coherence Misses"
+        << std::setw(11) << "Upgrades" << std::setw(15) << "Invalidations" << "Transfers" << std::endl;
+
+    for (int core = 0; core < system.cores(); ++core) {
+        const CacheStats& stats = system.l1(core).stats();
+        const CoreStats& coherence = system.coreStats(core);
+        std::ostringstream hit_rate;
+        hit_rate << std::fixed << std::setprecision(4) << (stats.hitRate() * 100.0) << "%";
+        std::cout << std::left << std::setw(7) << ("L1." + std::to_string(core)) << std::setw(14) << stats.accesses()
+            << std::setw(14) << stats.hits << std::setw(14) << stats.misses << std::setw(11) << hit_rate.str()
+            << std::setw(19) << coherence.coherence_misses << std::setw(11) << coherence.upgrades
+            << std::setw(15) << coherence.invalidations << coherence.transfers << std::endl;
+    }
+
+    const Cache* llc = system.llc();
+    if (llc != nullptr) {
+        //The LLC counts L1 fetches as its accesses, L1 write-backs only as traffic
+        const CacheStats& stats = llc->stats();
+        std::ostringstream hit_rate;
+        hit_rate << std::fixed << std::setprecision(4) << (stats.hitRate() * 100.0) << "%";
+        std::cout << std::left << std::setw(7) << levels[1].name << std::setw(14) << stats.accesses()
+            << std::setw(14) << stats.hits << std::setw(14) << stats.misses << hit_rate.str() << std::endl;
+    }
+
+    const BusStats& bus = system.bus();
+    std::cout << std::right << "Bus Reads: " << bus.reads << std::endl;
+    std::cout << "Bus Read-Exclusives: " << bus.read_exclusives << std::endl;
+    std::cout << "Bus Upgrades: " << bus.upgrades << std::endl;
+    if (system.protocol() == CoherenceProtocol::Mesi) {
+        std::cout << "Flushes: " << bus.flushes << std::endl;
+    }
+    if (llc != nullptr && levels[1].inclusion == Inclusion::Inclusive) {
+        std::cout << "Back-Invalidations: " << bus.back_invalidations << std::endl;
+    }
+    std::cout << "Memory Reads: " << bus.memory_reads << std::endl;
+    std::cout << "Memory Write-Backs: " << bus.memory_writebacks << std::endl;
+    std::cout << "Memory Traffic: " << bus.memory_bytes << " bytes" << std::endl;
+    std::cout << "-------------------------" << std::endl;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Cache.h"
+#include "Hierarchy.h"
+#include "Trace.h"
+
+//Multi-core simulation: one private L1 per core, kept coherent by snooping, in front of an
+//optional shared LLC.
+//
+//Every L1 is an ordinary write-back, write-allocate Cache. Its valid, dirty and shared bits
+//(see BlockState) encode the protocol state of each block:
+//  M  modified     valid, dirty, not shared
+//  O  owned        valid, dirty, shared (MOESI only)
+//  E  exclusive    valid, clean, not shared
+//  S  shared       valid, clean, shared
+//  I  invalid      not valid
+//Accesses are run one at a time in trace order, each on the L1 of the core named in the
+//record. A read miss (BusRd) snoops the other L1s: an M or O copy supplies the block
+//cache-to-cache, under MESI after writing it back to the LLC (M -> S), under MOESI keeping
+//it dirty (M -> O). A write miss (BusRdX) or a write to an S or O block (BusUpgr, an
+//upgrade) invalidates every other copy. E -> M needs no bus transaction. Blocks that no
+//other L1 supplies are read from the LLC, and dirty L1 victims are written back to it.
+
+enum class CoherenceProtocol {
+    Mesi,
+    Moesi
+};
+
+//Accepts MESI and MOESI in any case.
+//Prints an error and returns false for anything else.
+bool parseCoherenceProtocol(const std::string& name, CoherenceProtocol& protocol);
+
+const char* coherenceProtocolName(CoherenceProtocol protocol);
+
+//Checks that levels (from readHierarchyConfig) can be used with private L1s: at most a
+//shared L2, write-back write-allocate L1s and no exclusive LLC.
+//Prints an error and returns false otherwise.
+bool checkCoherentLevels(const std::vector<LevelConfig>& levels);
+
+
+//Coherence counters of one core, besides the CacheStats of its L1
+struct CoreStats {
+    long long coherence_misses = 0; //Misses to blocks another core's write invalidated here
+    long long upgrades = 0; //Writes to S or O blocks, which first invalidate the other copies
+    long long invalidations = 0; //Blocks of this L1 invalidated by other cores' writes
+    long long transfers = 0; //Blocks this L1 supplied to another core
+};
+
+//Bus transactions and what reached the LLC and memory
+struct BusStats {
+    long long reads = 0; //BusRd
+    long long read_exclusives = 0; //BusRdX
+    long long upgrades = 0; //BusUpgr
+    long long flushes = 0; //M blocks written back to the LLC when another core read them (MESI)
+    long long back_invalidations = 0; //L1 blocks dropped because an inclusive LLC evicted them
+    long long memory_reads = 0;
+    long long memory_writebacks = 0;
+    long long memory_bytes = 0;
+};
+
+
+class CoherentSystem {
+public:
+    //levels must have passed checkCoherentLevels. cores is at most 256.
+    CoherentSystem(const std::vector<LevelConfig>& levels, int cores, CoherenceProtocol protocol);
+
+    CoherentSystem(const CoherentSystem&) = delete;
+    CoherentSystem& operator=(const CoherentSystem&) = delete;
+
+    //Throws std::out_of_range for a record whose core ID is not below cores
+    void access(const TraceRecord* records, std::size_t count);
+
+    int cores() const { return (int)l1s_.size(); }
+    const Cache& l1(int core) const { return l1s_[core]; }
+    const CoreStats& coreStats(int core) const { return core_stats_[core]; }
+    CoherenceProtocol protocol() const { return protocol_; }
+
+    //nullptr if there is no shared level
+    const Cache* llc() const { return llc_.empty() ? nullptr : &llc_[0]; }
+
+    const BusStats& bus() const { return bus_; }
+
+private:
+    void accessCore(int core, unsigned long long address, bool write);
+
+    //Invalidates every other L1's copy of address. Returns true if one of them was dirty.
+    bool invalidateOthers(int core, unsigned long long address);
+
+    //Sends a fetch or write-back from an L1 down to the LLC, or to memory if there is none
+    void sendToLlc(const TraceRecord& record);
+    void sendToMemory(const TraceRecord& record, int block_size);
+
+    CoherenceProtocol protocol_;
+    int l1_block_size_;
+    std::vector<Cache> l1s_;
+    std::vector<CacheTraffic> l1_traffic_; //One per L1, never resized (the L1s point into it)
+    std::vector<CoreStats> core_stats_;
+    //Blocks invalidated by another core and not missed on since, per core
+    std::vector<std::unordered_set<unsigned long long>> invalidated_;
+    std::vector<Cache> llc_; //Empty, or the one shared level
+    CacheTraffic llc_traffic_;
+    BusStats bus_;
+};
+
+
+//Prints one row per core and one for the LLC, then the bus and memory counters
+void printCoherenceResults(const CoherentSystem& system, const std::vector<LevelConfig>& levels);
@@ -0,0 +1,239 @@
+#include "Compression.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef CACHESIM_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef CACHESIM_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef CACHESIM_WITH_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace {
+
+//Compressed bytes are pulled from the underlying source in chunks of this size
+const std::size_t COMPRESSED_CHUNK_SIZE = 1 << 18;
+
+#ifdef CACHESIM_WITH_ZLIB
+class GzipByteSource : public ByteSource {
+public:
+    explicit GzipByteSource(std::unique_ptr<ByteSource> compressed)
+        : compressed_(std::move(compressed)), input_(COMPRESSED_CHUNK_SIZE), input_eof_(false), finished_(false) {
+        stream_ = z_stream();
+        //15 + 32: full window, and accept both gzip and zlib headers
+        if (inflateInit2(&stream_, 15 + 32) != Z_OK) {
+            throw std::runtime_error("Could not initialize zlib");
+        }
+    }
+
+    ~GzipByteSource() { inflateEnd(&stream_); }
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        stream_.next_out = buffer;
+        stream_.avail_out = (uInt)size;
+
+        while (stream_.avail_out == size && !finished_) {
+            if (stream_.avail_in == 0 && !input_eof_) {
+                std::size_t got = compressed_->read(input_.data(), input_.size());
+                input_eof_ = (got == 0);
+                stream_.next_in = input_.data();
+                stream_.avail_in = (uInt)got;
+            }
+
+            int status = inflate(&stream_, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                //gzip files may hold several members back to back (e.g. from "cat a.gz b.gz")
+                if (stream_.avail_in == 0 && !input_eof_) {
+                    std::size_t got = compressed_->read(input_.data(), input_.size());
+                    input_eof_ = (got == 0);
+                    stream_.next_in = input_.data();
+                    stream_.avail_in = (uInt)got;
+                }
+                if (stream_.avail_in == 0) {
+                    finished_ = true;
+                }
+                else {
+                    inflateReset(&stream_);
+                }
+            }
+            else if (status == Z_BUF_ERROR && input_eof_ && stream_.avail_in == 0) {
+                throw std::runtime_error("Compressed trace (gzip) is truncated");
+            }
+            else if (status != Z_OK && status != Z_BUF_ERROR) {
+                throw std::runtime_error("Compressed trace (gzip) is corrupt");
+            }
+        }
+        return size - stream_.avail_out;
+    }
+
+private:
+    std::unique_ptr<ByteSource> compressed_;
+    std::vector<unsigned char> input_;
+    z_stream stream_;
+    bool input_eof_;
+    bool finished_;
+};
+#endif
+
+
+#ifdef CACHESIM_WITH_ZSTD
+class ZstdByteSource : public ByteSource {
+public:
+    explicit ZstdByteSource(std::unique_ptr<ByteSource> compressed)
+        : compressed_(std::move(compressed)), input_(ZSTD_DStreamInSize()), in_size_(0), in_pos_(0),
+          input_eof_(false), frame_done_(true) {
+        stream_ = ZSTD_createDStream();
+        if (stream_ == nullptr) {
+            throw std::runtime_error("Could not initialize zstd");
+        }
+    }
+
+    ~ZstdByteSource() { ZSTD_freeDStream(stream_); }
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        ZSTD_outBuffer out = { buffer, size, 0 };
+
+        while (out.pos == 0) {
+            if (in_pos_ == in_size_) {
+                if (input_eof_) break;
+                in_size_ = compressed_->read(input_.data(), input_.size());
+                in_pos_ = 0;
+                if (in_size_ == 0) {
+                    input_eof_ = true;
+                    if (!frame_done_) {
+                        throw std::runtime_error("Compressed trace (zstd) is truncated");
+                    }
+                    break;
+                }
+            }
+
+            //Consecutive frames are decoded one after another by the same stream
+            ZSTD_inBuffer in = { input_.data(), in_size_, in_pos_ };
+            std::size_t hint = ZSTD_decompressStream(stream_, &out, &in);
+            if (ZSTD_isError(hint)) {
+                throw std::runtime_error(std::string("Compressed trace (zstd) is corrupt: ") + ZSTD_getErrorName(hint));
+            }
+            in_pos_ = in.pos;
+            frame_done_ = (hint == 0);
+        }
+        return out.pos;
+    }
+
+private:
+    std::unique_ptr<ByteSource> compressed_;
+    std::vector<unsigned char> input_;
+    std::size_t in_size_;
+    std::size_t in_pos_;
+    ZSTD_DStream* stream_;
+    bool input_eof_;
+    bool frame_done_;
+};
+#endif
+
+
+#ifdef CACHESIM_WITH_LZ4
+class Lz4ByteSource : public ByteSource {
+public:
+    explicit Lz4ByteSource(std::unique_ptr<ByteSource> compressed)
+        : compressed_(std::move(compressed)), input_(COMPRESSED_CHUNK_SIZE), in_size_(0), in_pos_(0),
+          input_eof_(false), frame_done_(true) {
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&context_, LZ4F_VERSION))) {
+            throw std::runtime_error("Could not initialize lz4");
+        }
+    }
+
+    ~Lz4ByteSource() { LZ4F_freeDecompressionContext(context_); }
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        std::size_t produced = 0;
+
+        while (produced == 0) {
+            if (in_pos_ == in_size_) {
+                if (input_eof_) break;
+                in_size_ = compressed_->read(input_.data(), input_.size());
+                in_pos_ = 0;
+                if (in_size_ == 0) {
+                    input_eof_ = true;
+                    if (!frame_done_) {
+                        throw std::runtime_error("Compressed trace (lz4) is truncated");
+                    }
+                    break;
+                }
+            }
+
+            std::size_t out_size = size - produced;
+            std::size_t in_size = in_size_ - in_pos_;
+            std::size_t hint = LZ4F_decompress(context_, buffer + produced, &out_size,
+                input_.data() + in_pos_, &in_size, nullptr);
+            if (LZ4F_isError(hint)) {
+                throw std::runtime_error(std::string("Compressed trace (lz4) is corrupt: ") + LZ4F_getErrorName(hint));
+            }
+            in_pos_ += in_size;
+            produced += out_size;
+            //A hint of 0 means the frame is complete, the next bytes start a new one
+            frame_done_ = (hint == 0);
+        }
+        return produced;
+    }
+
+private:
+    std::unique_ptr<ByteSource> compressed_;
+    std::vector<unsigned char> input_;
+    std::size_t in_size_;
+    std::size_t in_pos_;
+    LZ4F_dctx* context_;
+    bool input_eof_;
+    bool frame_done_;
+};
+#endif
+
+} // namespace
+
+
+Compression detectCompression(const unsigned char* header, std::size_t size) {
+    if (size >= 2 && header[0] == 0x1F && header[1] == 0x8B) {
+        return Compression::Gzip;
+    }
+    if (size >= 4 && header[0] == 0x28 && header[1] == 0xB5 && header[2] == 0x2F && header[3] == 0xFD) {
+        return Compression::Zstd;
+    }
+    if (size >= 4 && header[0] == 0x04 && header[1] == 0x22 && header[2] == 0x4D && header[3] == 0x18) {
+        return Compression::Lz4;
+    }
+    return Compression::None;
+}
+
+
+const char* compressionName(Compression compression) {
+    switch (compression) {
+    case Compression::Gzip: return "gzip";
+    case Compression::Zstd: return "zstd";
+    case Compression::Lz4: return "lz4";
+    default: return "none";
+    }
+}
+
+
+std::unique_ptr<ByteSource> openDecompressor(std::unique_ptr<ByteSource> compressed, Compression compression) {
+    switch (compression) {
+#ifdef CACHESIM_WITH_ZLIB
+    case Compression::Gzip: return std::unique_ptr<ByteSource>(new GzipByteSource(std::move(compressed)));
+#endif
+#ifdef CACHESIM_WITH_ZSTD
+    case Compression::Zstd: return std::unique_ptr<ByteSource>(new ZstdByteSource(std::move(compressed)));
+#endif
+#ifdef CACHESIM_WITH_LZ4
+    case Compression::Lz4: return std::unique_ptr<ByteSource>(new Lz4ByteSource(std::move(compressed)));
+#endif
+    case Compression::None: return compressed;
+    default: break;
+    }
+    std::cerr << "Error: The trace is " << compressionName(compression)
+        << " compressed, but this build has no " << compressionName(compression) << " support" << std::endl;
+    return nullptr;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "Trace.h"
+
+//Streaming decompression of archived traces (.gz, .zst, .lz4).
+//
+//Each codec is compiled in only when its library is available: define CACHESIM_WITH_ZLIB,
+//CACHESIM_WITH_ZSTD and/or CACHESIM_WITH_LZ4 and link zlib, libzstd and liblz4.
+//A compressed trace is recognised by its magic bytes, the file name does not matter.
+
+enum class Compression {
+    None,
+    Gzip,
+    Zstd,
+    Lz4
+};
+
+//Looks at the first bytes of a stream (up to 8 are used)
+Compression detectCompression(const unsigned char* header, std::size_t size);
+
+const char* compressionName(Compression compression);
+
+//Wraps a compressed byte stream in one that yields the decompressed bytes.
+//Prints an error and returns nullptr if this build has no support for the codec.
+std::unique_ptr<ByteSource> openDecompressor(std::unique_ptr<ByteSource> compressed, Compression compression);
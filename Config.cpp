@@ -0,0 +1,260 @@
+#include "Config.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cerrno>
+#include <climits>
+#include <cctype>
+
+namespace {
+
+//text without leading and trailing whitespace (and the '\r' of a Windows line end)
+std::string trim(const std::string& text) {
+    std::size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool isKey(const std::string& key) {
+    if (key.empty()) {
+        return false;
+    }
+    for (char c : key) {
+        if (!(std::isupper((unsigned char)c) || std::isdigit((unsigned char)c) || c == '_')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+std::string toUpper(const std::string& name) {
+    std::string upper = name;
+    for (char& c : upper) {
+        c = (char)std::toupper((unsigned char)c);
+    }
+    return upper;
+}
+
+
+bool parseInteger(const std::string& text, long long& value) {
+    //strtoll accepts leading whitespace and stops at the first junk character, both of
+    //which are errors here
+    if (text.empty() || std::isspace((unsigned char)text[0])) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtoll(text.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+
+bool Config::require(const std::string& key) const {
+    if (!has(key)) {
+        std::cerr << "Error: Missing " << key << " in config.ini" << (name_.empty() ? "" : " [" + name_ + "]") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+const Config::Entry* Config::find(const std::string& key) const {
+    std::map<std::string, Entry>::const_iterator it = entries_.find(key);
+    if (it == entries_.end()) {
+        return nullptr;
+    }
+    it->second.used = true;
+    return &it->second;
+}
+
+
+bool Config::invalid(const std::string& key, const Entry& entry, const char* expected) const {
+    std::cerr << "Error: " << key << " must be " << expected << ", got '" << entry.value << "' (" << entry.where << ")" << std::endl;
+    return false;
+}
+
+
+bool Config::read(const std::string& key, std::string& value) const {
+    const Entry* entry = find(key);
+    if (entry != nullptr) {
+        value = entry->value;
+    }
+    return true;
+}
+
+
+bool Config::read(const std::string& key, int& value) const {
+    const Entry* entry = find(key);
+    if (entry == nullptr) {
+        return true;
+    }
+    long long parsed;
+    if (!parseInteger(entry->value, parsed) || parsed < INT_MIN || parsed > INT_MAX) {
+        return invalid(key, *entry, "an integer");
+    }
+    value = (int)parsed;
+    return true;
+}
+
+
+bool Config::read(const std::string& key, long long& value) const {
+    const Entry* entry = find(key);
+    if (entry == nullptr) {
+        return true;
+    }
+    if (!parseInteger(entry->value, value)) {
+        return invalid(key, *entry, "an integer");
+    }
+    return true;
+}
+
+
+bool Config::read(const std::string& key, unsigned long long& value) const {
+    const Entry* entry = find(key);
+    if (entry == nullptr) {
+        return true;
+    }
+    //strtoull would wrap a negative number around
+    const std::string& text = entry->value;
+    if (text.empty() || !std::isdigit((unsigned char)text[0])) {
+        return invalid(key, *entry, "a non-negative integer");
+    }
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return invalid(key, *entry, "a non-negative integer");
+    }
+    value = parsed;
+    return true;
+}
+
+
+bool Config::read(const std::string& key, double& value) const {
+    const Entry* entry = find(key);
+    if (entry == nullptr) {
+        return true;
+    }
+    const std::string& text = entry->value;
+    if (text.empty() || std::isspace((unsigned char)text[0])) {
+        return invalid(key, *entry, "a number");
+    }
+    char* end = nullptr;
+    errno = 0;
+    double parsed = std::strtod(text.c_str(), &end);
+    if (errno != 0 || *end != '\0') {
+        return invalid(key, *entry, "a number");
+    }
+    value = parsed;
+    return true;
+}
+
+
+bool Config::readFlag(const std::string& key, bool& value) const {
+    const Entry* entry = find(key);
+    if (entry == nullptr) {
+        return true;
+    }
+    std::string upper = toUpper(entry->value);
+    if (upper == "1" || upper == "TRUE" || upper == "ON" || upper == "YES") {
+        value = true;
+    }
+    else if (upper == "0" || upper == "FALSE" || upper == "OFF" || upper == "NO") {
+        value = false;
+    }
+    else {
+        return invalid(key, *entry, "0 or 1");
+    }
+    return true;
+}
+
+
+void Config::set(const std::string& key, const std::string& value, const std::string& where) {
+    Entry entry = { value, where, false };
+    entries_[key] = entry;
+}
+
+
+int Config::warnUnusedKeys() const {
+    int unused = 0;
+    for (const std::pair<const std::string, Entry>& entry : entries_) {
+        if (!entry.second.used) {
+            std::cerr << "Warning: " << entry.first << " (" << entry.second.where << ") is not used by this run" << std::endl;
+            unused++;
+        }
+    }
+    return unused;
+}
+
+
+bool loadConfigs(const std::string& filename, std::vector<Config>& configs) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open config file " << filename << std::endl;
+        return false;
+    }
+
+    //The shared keys are copied into every section as it starts, so keys after the first
+    //header only change their own section
+    Config shared;
+    configs.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        std::string text = trim(line);
+        if (text.empty() || text[0] == '#' || text[0] == ';') {
+            continue;
+        }
+        std::string where = filename + " line " + std::to_string(line_number);
+
+        //1. A [NAME] header starts the next configuration
+        if (text[0] == '[') {
+            std::string name = (text.back() == ']') ? trim(text.substr(1, text.size() - 2)) : "";
+            if (name.empty()) {
+                std::cerr << "Error: Expected [NAME] (" << where << ")" << std::endl;
+                return false;
+            }
+            for (const Config& config : configs) {
+                if (config.name() == name) {
+                    std::cerr << "Error: Section [" << name << "] appears twice (" << where << ")" << std::endl;
+                    return false;
+                }
+            }
+            configs.push_back(shared);
+            configs.back().name_ = name;
+            continue;
+        }
+
+        //2. Anything else is KEY: VALUE
+        std::size_t colon = text.find(':');
+        std::string key = (colon == std::string::npos) ? "" : trim(text.substr(0, colon));
+        if (key.empty()) {
+            std::cerr << "Error: Expected KEY: VALUE, got '" << text << "' (" << where << ")" << std::endl;
+            return false;
+        }
+        (configs.empty() ? shared : configs.back()).set(key, trim(text.substr(colon + 1)), where);
+    }
+
+    if (configs.empty()) {
+        configs.push_back(shared);
+    }
+    return true;
+}
+
+
+bool parseOverride(const std::string& argument, std::string& key, std::string& value) {
+    std::size_t equals = argument.find('=');
+    if (equals == std::string::npos || !isKey(argument.substr(0, equals))) {
+        return false;
+    }
+    key = argument.substr(0, equals);
+    value = trim(argument.substr(equals + 1));
+    return true;
+}
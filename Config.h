@@ -0,0 +1,82 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+//The settings of a simulation, as KEY: VALUE pairs.
+//
+//config.ini may hold several configurations. The keys before the first [NAME] header are
+//shared, and every [NAME] section is one configuration made of the shared keys plus its
+//own, which win. A file without sections is a single configuration. Blank lines and lines
+//starting with # or ; are skipped.
+//
+//Values are kept as text and checked when they are read: a number with trailing junk or
+//out of range is an error naming the key and where it was set, not an exception or a
+//silent 0. Every read marks its key as used, so a key that nothing read (most likely a
+//misspelled one) can be reported once the run has read its keys.
+
+class Config {
+public:
+    explicit Config(const std::string& name = "") : name_(name) {}
+
+    //The [NAME] of the section, empty for a file without sections
+    const std::string& name() const { return name_; }
+
+    bool has(const std::string& key) const { return entries_.count(key) != 0; }
+
+    //Prints an error and returns false if key is missing
+    bool require(const std::string& key) const;
+
+    //Each read leaves value alone (the default) and returns true if key is missing.
+    //Prints an error and returns false if the value does not parse.
+    bool read(const std::string& key, std::string& value) const;
+    bool read(const std::string& key, int& value) const;
+    bool read(const std::string& key, long long& value) const;
+    bool read(const std::string& key, unsigned long long& value) const;
+    bool read(const std::string& key, double& value) const;
+
+    //0 or 1, or TRUE / FALSE, ON / OFF, YES / NO in any case
+    bool readFlag(const std::string& key, bool& value) const;
+
+    //Sets key. where says where the value came from, for errors ("config.ini line 3").
+    void set(const std::string& key, const std::string& value, const std::string& where);
+
+    //Prints a warning naming every key that no read has looked at, and where it was set:
+    //a misspelled key, or one for another mode. Returns how many there were.
+    int warnUnusedKeys() const;
+
+private:
+    friend bool loadConfigs(const std::string& filename, std::vector<Config>& configs);
+
+    struct Entry {
+        std::string value;
+        std::string where;
+        mutable bool used;
+    };
+
+    //The entry of key, nullptr if it is missing. Marks it used.
+    const Entry* find(const std::string& key) const;
+
+    //Prints that key (set at entry) is not what expected describes
+    bool invalid(const std::string& key, const Entry& entry, const char* expected) const;
+
+    std::string name_;
+    std::map<std::string, Entry> entries_;
+};
+
+
+//Reads filename into one Config per section, or a single one for a file without sections.
+//Prints an error and returns false if the file cannot be opened or a line is malformed.
+bool loadConfigs(const std::string& filename, std::vector<Config>& configs);
+
+//Splits a "KEY=VALUE" command line argument. Returns false for anything else, so file
+//names and other arguments are left alone: KEY is upper case letters, digits and '_'.
+bool parseOverride(const std::string& argument, std::string& key, std::string& value);
+
+//name in upper case, for the parsers of names that are accepted in any case
+std::string toUpper(const std::string& name);
+
+//Parses all of text as a base 10 integer: no whitespace, no trailing junk, no overflow.
+//Returns false otherwise.
+bool parseInteger(const std::string& text, long long& value);
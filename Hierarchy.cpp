@@ -0,0 +1,229 @@
+#include "Hierarchy.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+bool parseInclusion(const std::string& name, Inclusion& inclusion) {
+    std::string upper = toUpper(name);
+
+    const Inclusion all[] = { Inclusion::Nine, Inclusion::Inclusive, Inclusion::Exclusive };
+    for (Inclusion candidate : all) {
+        if (upper == inclusionName(candidate)) {
+            inclusion = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported inclusion policy " << name << " (expected NINE, INCLUSIVE or EXCLUSIVE)" << std::endl;
+    return false;
+}
+
+
+const char* inclusionName(Inclusion inclusion) {
+    switch (inclusion) {
+    case Inclusion::Nine: return "NINE";
+    case Inclusion::Inclusive: return "INCLUSIVE";
+    case Inclusion::Exclusive: return "EXCLUSIVE";
+    }
+    return "unknown";
+}
+
+
+namespace {
+
+//Reads key if it is set. Text always reads, so the result only says whether it was there.
+bool readText(const Config& config, const std::string& key, std::string& value) {
+    return config.has(key) && config.read(key, value);
+}
+
+//Short form of a level's write policies for the results table: WB or WT, then WA or NWA
+std::string writeModeName(const LevelConfig& level) {
+    std::string name = (level.write_policy == WritePolicy::WriteBack) ? "WB" : "WT";
+    return name + ((level.write_miss_policy == WriteMissPolicy::WriteAllocate) ? "/WA" : "/NWA");
+}
+
+} // namespace
+
+
+bool readCacheShape(const Config& config, const std::string& prefix, long long& cache_size_kb, int& block_size, int& associativity) {
+    return config.require(prefix + "CACHE_SIZE_KB") && config.require(prefix + "BLOCK_SIZE_BYTES") &&
+        config.require(prefix + "ASSOCIATIVITY") && config.read(prefix + "CACHE_SIZE_KB", cache_size_kb) &&
+        config.read(prefix + "BLOCK_SIZE_BYTES", block_size) && config.read(prefix + "ASSOCIATIVITY", associativity);
+}
+
+
+bool readHierarchyConfig(const Config& config, std::vector<LevelConfig>& levels) {
+    int count = 1;
+    if (!config.read("LEVELS", count)) {
+        return false;
+    }
+    if (count < 1) {
+        std::cerr << "Error: LEVELS must be at least 1." << std::endl;
+        return false;
+    }
+
+    for (int n = 1; n <= count; ++n) {
+        LevelConfig level;
+        level.name = "L" + std::to_string(n);
+        std::string prefix = (n == 1) ? "" : level.name + "_";
+
+        int block_size = 0, associativity = 0;
+        if (!readCacheShape(config, prefix, level.cache_size_kb, block_size, associativity) ||
+            !computeGeometry(level.cache_size_kb * 1024, block_size, associativity, level.geometry)) {
+            return false;
+        }
+        std::string value;
+        if (readText(config, prefix + "REPLACEMENT_POLICY", value) && !parseReplacementPolicy(value, level.policy)) {
+            return false;
+        }
+        if (n > 1 && readText(config, prefix + "INCLUSION", value) && !parseInclusion(value, level.inclusion)) {
+            return false;
+        }
+        if (readText(config, prefix + "WRITE_POLICY", value) && !parseWritePolicy(value, level.write_policy)) {
+            return false;
+        }
+        if (readText(config, prefix + "WRITE_MISS_POLICY", value) && !parseWriteMissPolicy(value, level.write_miss_policy)) {
+            return false;
+        }
+        if (!readIndexConfig(config, prefix, level.index) || !checkIndexConfig(level.index, level.geometry, level.policy) ||
+            !readPrefetchConfig(config, prefix, level.prefetch)) {
+            return false;
+        }
+        if (level.index.function == IndexFunction::Skewed && level.prefetch.kind != PrefetcherKind::None) {
+            std::cerr << "Error: A SKEWED " << level.name << " cannot prefetch" << std::endl;
+            return false;
+        }
+
+        //Blocks are tracked at the granularity of the level above
+        if (n > 1) {
+            const LevelConfig& above = levels.back();
+            if (level.geometry.block_size < above.geometry.block_size) {
+                std::cerr << "Error: " << level.name << " blocks are smaller than " << above.name << " blocks" << std::endl;
+                return false;
+            }
+            if (level.inclusion == Inclusion::Exclusive && level.geometry.block_size != above.geometry.block_size) {
+                std::cerr << "Error: Exclusive " << level.name << " needs the block size of " << above.name << std::endl;
+                return false;
+            }
+            if (level.inclusion == Inclusion::Exclusive && level.prefetch.kind != PrefetcherKind::None) {
+                std::cerr << "Error: Exclusive " << level.name << " cannot prefetch" << std::endl;
+                return false;
+            }
+        }
+        levels.push_back(level);
+    }
+    return true;
+}
+
+
+CacheHierarchy::CacheHierarchy(const std::vector<LevelConfig>& levels)
+    : configs_(levels), traffic_(levels.size()), back_invalidations_(levels.size(), 0), memory_reads_(0),
+      memory_writebacks_(0), memory_write_throughs_(0), memory_bytes_(0) {
+    caches_.reserve(levels.size());
+    for (std::size_t i = 0; i < levels.size(); ++i) {
+        caches_.emplace_back(levels[i].geometry, levels[i].policy, levels[i].write_policy, levels[i].write_miss_policy);
+        caches_[i].setIndexFunction(levels[i].index);
+
+        //traffic_ is never resized, so the caches can keep pointers into it
+        CacheLinks links;
+        links.traffic = &traffic_[i];
+        links.exclusive = (i > 0 && levels[i].inclusion == Inclusion::Exclusive);
+        links.send_victims = (i + 1 < levels.size() && levels[i + 1].inclusion == Inclusion::Exclusive);
+        links.report_evictions = (i > 0 && levels[i].inclusion == Inclusion::Inclusive);
+        caches_[i].link(links);
+        caches_[i].enablePrefetching(levels[i].prefetch);
+    }
+}
+
+
+void CacheHierarchy::access(const TraceRecord* records, std::size_t count) {
+    //1. Run the batch down the levels, each one working on what the level above sent it
+    const TraceRecord* input = records;
+    std::size_t input_count = count;
+    for (std::size_t i = 0; i < caches_.size(); ++i) {
+        traffic_[i].clear();
+        caches_[i].access(input, input_count);
+        input = traffic_[i].down.data();
+        input_count = traffic_[i].down.size();
+    }
+
+    //2. Whatever the last level sent down went to memory
+    const int memory_block = configs_.back().geometry.block_size;
+    for (std::size_t i = 0; i < input_count; ++i) {
+        switch (input[i].access_type) {
+        case 'R': memory_reads_++; memory_bytes_ += memory_block; break;
+        case ACCESS_WRITEBACK: memory_writebacks_++; memory_bytes_ += memory_block; break;
+        case 'W': memory_write_throughs_++; memory_bytes_ += WRITE_THROUGH_BYTES; break;
+        default: break;
+        }
+    }
+
+    //3. A dirty block an exclusive level moved up is dirty in the first level that holds it
+    //now: the level that asked for it, or one it was evicted to later in the batch. If it
+    //left the hierarchy clean in the meantime, it still had to be written to memory.
+    for (std::size_t i = 1; i < caches_.size(); ++i) {
+        for (unsigned long long address : traffic_[i].moved_up_dirty) {
+            std::size_t holder = 0;
+            while (holder < caches_.size() && !caches_[holder].blockState(address).valid) {
+                holder++;
+            }
+            if (holder < caches_.size()) {
+                caches_[holder].setBlockState(address, true, caches_[holder].blockState(address).shared);
+            }
+            else {
+                memory_writebacks_++;
+                memory_bytes_ += configs_[i].geometry.block_size;
+            }
+        }
+    }
+
+    //4. Back-invalidate what the inclusive levels evicted, in every block of the levels above
+    for (std::size_t i = 1; i < caches_.size(); ++i) {
+        const int block_size = configs_[i].geometry.block_size;
+        for (unsigned long long evicted : traffic_[i].evicted) {
+            for (std::size_t above = 0; above < i; ++above) {
+                const int step = configs_[above].geometry.block_size;
+                for (unsigned long long address = evicted; address < evicted + block_size; address += step) {
+                    bool dirty = false;
+                    if (caches_[above].invalidate(address, &dirty)) {
+                        back_invalidations_[i]++;
+                        if (dirty) {
+                            memory_writebacks_++;
+                            memory_bytes_ += step;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void printHierarchyResults(const CacheHierarchy& hierarchy, const std::vector<LevelConfig>& levels) {
+    std::cout << "\n--- Hierarchy Results ---" << std::endl;
+    std::cout << std::left << std::setw(7) << "Level" << std::setw(10) << "Size KB" << std::setw(7) << "Block"
+        << std::setw(7) << "Ways" << std::setw(8) << "Policy" << std::setw(11) << "Inclusion" << std::setw(8) << "Write"
+        << std::setw(14) << "Accesses" << std::setw(14) << "Hits" << std::setw(14) << "Misses"
+        << std::setw(11) << "Hit Rate" << std::setw(14) << "Write-Backs" << std::setw(14) << "Prefetches"
+        << std::setw(14) << "Useful" << "Back-Invalidations" << std::endl;
+
+    for (std::size_t i = 0; i < hierarchy.levels(); ++i) {
+        const LevelConfig& level = levels[i];
+        const CacheStats& stats = hierarchy.level(i).stats();
+        std::ostringstream hit_rate;
+        hit_rate << std::fixed << std::setprecision(4) << (stats.hitRate() * 100.0) << "%";
+        std::cout << std::left << std::setw(7) << level.name << std::setw(10) << level.cache_size_kb
+            << std::setw(7) << level.geometry.block_size << std::setw(7) << level.geometry.associativity
+            << std::setw(8) << replacementPolicyName(level.policy) << std::setw(11) << ((i == 0) ? "-" : inclusionName(level.inclusion))
+            << std::setw(8) << writeModeName(level)
+            << std::setw(14) << stats.accesses() << std::setw(14) << stats.hits << std::setw(14) << stats.misses
+            << std::setw(11) << hit_rate.str() << std::setw(14) << stats.writebacks << std::setw(14) << stats.prefetches
+            << std::setw(14) << stats.useful_prefetches << hierarchy.backInvalidations(i) << std::endl;
+    }
+    std::cout << std::right << "Memory Reads: " << hierarchy.memoryReads() << std::endl;
+    std::cout << "Memory Write-Backs: " << hierarchy.memoryWritebacks() << std::endl;
+    std::cout << "Memory Write-Throughs: " << hierarchy.memoryWriteThroughs() << std::endl;
+    std::cout << "Memory Traffic: " << hierarchy.memoryTrafficBytes() << " bytes" << std::endl;
+    std::cout << "-------------------------" << std::endl;
+}
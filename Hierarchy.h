@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "Config.h"
+#include "Prefetcher.h"
+#include "ReplacementPolicy.h"
+#include "Trace.h"
+
+//A stack of caches, L1 first, in front of memory.
+//
+//Each level is an ordinary Cache. A batch of trace records runs through L1, whose misses
+//(and victims, when the next level wants them) are collected in order and run through L2
+//as the next batch, and so on, so every level works on whole batches with its own
+//specialized engine. How a level relates to the levels above it:
+//  NINE       non-inclusive, non-exclusive: filled on its own misses, evicts freely
+//  INCLUSIVE  like NINE, but every block it evicts is also invalidated above it
+//             (back-invalidation)
+//  EXCLUSIVE  holds only blocks evicted from the level above (a victim cache). A hit
+//             moves the block up, dirty if it was, and a miss is not filled here.
+//Back-invalidations, and the dirty bits of blocks moved up, are applied once the batch has
+//reached the bottom of the hierarchy, so both hold at batch boundaries, see
+//HIERARCHY_BATCH_SIZE.
+//Writes follow each level's write policies: dirty victims go down as ACCESS_WRITEBACK,
+//written-through and non-allocated writes as 'W'. A dirty block dropped by a
+//back-invalidation is written straight to memory.
+
+enum class Inclusion {
+    Nine,
+    Inclusive,
+    Exclusive
+};
+
+//Accepts NINE, INCLUSIVE and EXCLUSIVE in any case.
+//Prints an error and returns false for anything else.
+bool parseInclusion(const std::string& name, Inclusion& inclusion);
+
+const char* inclusionName(Inclusion inclusion);
+
+//Trace records per batch in hierarchy mode. Smaller than TRACE_BATCH_SIZE so the window in
+//which a back-invalidated block can still hit above stays short.
+const std::size_t HIERARCHY_BATCH_SIZE = 256;
+
+//One level of the hierarchy
+struct LevelConfig {
+    std::string name; //"L1", "L2", ...
+    long long cache_size_kb = 0;
+    CacheGeometry geometry;
+    ReplacementPolicy policy = ReplacementPolicy::Lru;
+    Inclusion inclusion = Inclusion::Nine; //Towards the levels above, unused for L1
+    WritePolicy write_policy = WritePolicy::WriteBack;
+    WriteMissPolicy write_miss_policy = WriteMissPolicy::WriteAllocate;
+    IndexConfig index;
+    PrefetchConfig prefetch;
+};
+
+//Reads prefix + CACHE_SIZE_KB, BLOCK_SIZE_BYTES and ASSOCIATIVITY, which are required.
+//Prints an error and returns false if one is missing or not an integer.
+bool readCacheShape(const Config& config, const std::string& prefix, long long& cache_size_kb, int& block_size, int& associativity);
+
+//Reads LEVELS and the per-level keys from the config: L1 uses the plain CACHE_SIZE_KB,
+//BLOCK_SIZE_BYTES, ASSOCIATIVITY, REPLACEMENT_POLICY, WRITE_POLICY, WRITE_MISS_POLICY, index
+//(see readIndexConfig) and prefetcher keys (see readPrefetchConfig), level n the same keys
+//prefixed with "Ln_", plus Ln_INCLUSION (default NINE).
+//Prints an error and returns false if a level is missing or cannot be stacked.
+bool readHierarchyConfig(const Config& config, std::vector<LevelConfig>& levels);
+
+
+class CacheHierarchy {
+public:
+    //levels must have passed readHierarchyConfig
+    explicit CacheHierarchy(const std::vector<LevelConfig>& levels);
+
+    CacheHierarchy(const CacheHierarchy&) = delete;
+    CacheHierarchy& operator=(const CacheHierarchy&) = delete;
+
+    void access(const TraceRecord* records, std::size_t count);
+
+    std::size_t levels() const { return caches_.size(); }
+    const Cache& level(std::size_t level) const { return caches_[level]; }
+
+    //Blocks invalidated above because this level evicted them (inclusive levels)
+    long long backInvalidations(std::size_t level) const { return back_invalidations_[level]; }
+
+    //What reached memory: blocks fetched by the last level, dirty blocks written back (by
+    //the last level or dropped by back-invalidations) and single written-through words
+    long long memoryReads() const { return memory_reads_; }
+    long long memoryWritebacks() const { return memory_writebacks_; }
+    long long memoryWriteThroughs() const { return memory_write_throughs_; }
+    long long memoryTrafficBytes() const { return memory_bytes_; }
+
+private:
+    std::vector<LevelConfig> configs_;
+    std::vector<Cache> caches_;
+    std::vector<CacheTraffic> traffic_; //What each level sends down
+    std::vector<long long> back_invalidations_;
+    long long memory_reads_;
+    long long memory_writebacks_;
+    long long memory_write_throughs_;
+    long long memory_bytes_;
+};
+
+
+//Prints one row per level and the memory traffic
+void printHierarchyResults(const CacheHierarchy& hierarchy, const std::vector<LevelConfig>& levels);
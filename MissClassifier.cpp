@@ -0,0 +1,65 @@
+#include "MissClassifier.h"
+
+const unsigned int MissClassifier::NOT_RESIDENT;
+
+MissClassifier::MissClassifier(long long blocks)
+    : nodes_((std::size_t)blocks), used_nodes_(0), head_(0) {}
+
+
+ShadowResult MissClassifier::access(unsigned long long block) {
+    //A new block is not resident yet. Growing the table moves the resident blocks' entries.
+    bool inserted;
+    std::size_t entry = table_.insert(block, NOT_RESIDENT, inserted,
+        [this](unsigned long long, unsigned int node, std::size_t moved_to) {
+            if (node != NOT_RESIDENT) {
+                nodes_[node].entry = (unsigned int)moved_to;
+            }
+        });
+    unsigned int node = table_.value(entry);
+
+    //1. A hit moves the block to the front of the LRU list
+    if (node != NOT_RESIDENT) {
+        if (node != head_) {
+            Node& moved = nodes_[node];
+            if (node != nodes_[head_].prev) {
+                //Unlink it and put it back in just before the head, where the tail is
+                nodes_[moved.prev].next = moved.next;
+                nodes_[moved.next].prev = moved.prev;
+                unsigned int tail = nodes_[head_].prev;
+                moved.prev = tail;
+                moved.next = head_;
+                nodes_[tail].next = node;
+                nodes_[head_].prev = node;
+            }
+            //The tail is already just before the head, the list only has to turn
+            head_ = node;
+        }
+        return ShadowResult::Hit;
+    }
+
+    //2. A miss takes a free node, or the tail's once the shadow is full
+    if (used_nodes_ < nodes_.size()) {
+        node = used_nodes_++;
+        Node& added = nodes_[node];
+        if (node == 0) {
+            added.prev = node;
+            added.next = node;
+        }
+        else {
+            unsigned int tail = nodes_[head_].prev;
+            added.prev = tail;
+            added.next = head_;
+            nodes_[tail].next = node;
+            nodes_[head_].prev = node;
+        }
+    }
+    else {
+        node = nodes_[head_].prev;
+        table_.value(nodes_[node].entry) = NOT_RESIDENT;
+    }
+    nodes_[node].entry = (unsigned int)entry;
+    table_.value(entry) = node;
+    head_ = node;
+    return inserted ? ShadowResult::FirstTouch : ShadowResult::Miss;
+}
+
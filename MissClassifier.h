@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "BlockTable.h"
+
+//3C miss classification (Hill and Smith, 1989).
+//
+//A miss of the real cache is
+//  compulsory  if its block was never accessed before,
+//  capacity    if a fully-associative LRU cache of the same size misses it too,
+//  conflict    otherwise: only the way the blocks are spread over the sets made it miss.
+//
+//The classifier runs that shadow cache next to the real one. One BlockTable holds every
+//block ever seen, so it is both the "seen" set and the index of the
+//shadow, and the resident blocks are nodes of an intrusive circular LRU list. Every access
+//costs one table probe and a few pointer updates, however large the cache is.
+
+//What the shadow cache made of an access
+enum class ShadowResult {
+    FirstTouch, //Never seen before
+    Miss, //Seen, but evicted from the shadow since
+    Hit
+};
+
+class MissClassifier {
+public:
+    //blocks is the capacity of the real cache in blocks
+    explicit MissClassifier(long long blocks);
+
+    //Runs one demand access to block (address >> offset bits) through the shadow cache.
+    //Has to see every demand access of the real cache, hits included.
+    ShadowResult access(unsigned long long block);
+
+    //Starts loading the table entry of a block that is about to be accessed
+    void prefetch(unsigned long long block) const {
+        table_.prefetch(block);
+    }
+
+private:
+    static const unsigned int NOT_RESIDENT = 0xFFFFFFFEu;
+
+    //One resident block, linked in LRU order
+    struct Node {
+        unsigned int entry; //Its table entry
+        unsigned int prev; //Towards the least recently used, the head's prev is the tail
+        unsigned int next;
+    };
+    std::vector<Node> nodes_;
+    unsigned int used_nodes_;
+    unsigned int head_; //Most recently used node
+
+    BlockTable table_; //Block number to its node, NOT_RESIDENT once evicted from the shadow
+};
@@ -0,0 +1,64 @@
+#include "Partition.h"
+
+#include <vector>
+
+#include "TraceBroadcast.h"
+
+int partitionShards(const CacheGeometry& geometry, int threads) {
+    //Largest power of two that is <= threads and does not exceed the number of indexed sets
+    int shard_bits = 0;
+    while (shard_bits < geometry.index_bits && (2 << shard_bits) <= threads) {
+        shard_bits++;
+    }
+    return 1 << shard_bits;
+}
+
+
+CacheStats runPartitioned(TraceReader& trace, const CacheGeometry& geometry, ReplacementPolicy policy,
+    WritePolicy write_policy, WriteMissPolicy write_miss_policy, int shards) {
+    int shard_bits = 0;
+    while ((1 << shard_bits) < shards) {
+        shard_bits++;
+    }
+
+    //Every shard owns 1/shards of the sets and indexes them with the remaining index bits
+    CacheGeometry shard_geometry = geometry;
+    shard_geometry.index_bits = geometry.index_bits - shard_bits;
+    shard_geometry.num_sets = 1 << shard_geometry.index_bits;
+    shard_geometry.cache_size = geometry.cache_size / shards;
+
+    const int offset_bits = geometry.offset_bits;
+    const unsigned long long offset_mask = (1ULL << offset_bits) - 1;
+    const unsigned long long shard_mask = (unsigned long long)shards - 1;
+    std::vector<CacheStats> shard_stats(shards);
+
+    broadcastTrace(trace, shards, [&](int shard, TraceChunkReader& reader) {
+        //Built on the shard's own thread, see sweepWorker
+        Cache cache(shard_geometry, policy, write_policy, write_miss_policy);
+        std::vector<TraceRecord> mine(BROADCAST_CHUNK_RECORDS);
+
+        const TraceRecord* records;
+        std::size_t count;
+        while (reader.next(records, count)) {
+            //Pick out this shard's accesses, dropping the shard bits from the index
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                unsigned long long address = records[i].address;
+                unsigned long long block = address >> offset_bits;
+                mine[kept].address = ((block >> shard_bits) << offset_bits) | (address & offset_mask);
+                mine[kept].access_type = records[i].access_type;
+                mine[kept].core = records[i].core;
+                kept += ((block & shard_mask) == (unsigned long long)shard);
+            }
+            cache.access(mine.data(), kept);
+        }
+        shard_stats[shard] = cache.stats();
+    });
+
+    //Merge the per-shard totals
+    CacheStats total;
+    for (const CacheStats& stats : shard_stats) {
+        total.add(stats);
+    }
+    return total;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Cache.h"
+#include "Trace.h"
+
+//Set-partitioned simulation of one cache.
+//
+//Sets never interact, so the sets are split into 2^k shards by the low k index bits and
+//every shard is simulated by its own thread. Each shard is an ordinary Cache with 2^k times
+//fewer sets, fed addresses with those k bits removed, so it computes the same tag and the
+//same (renumbered) set as the full cache. Every shard keeps its own replacement state: it
+//only has to order the accesses to sets in that shard, and it sees them in trace order, so
+//with the per-set policies (LRU, PLRU, SRRIP, FIFO) every eviction is exactly the one the
+//serial run makes. BRRIP and RANDOM draw from one sequence per cache, so their choices
+//depend on the number of shards.
+
+//How many shards a geometry can be split into with at most `threads` threads
+int partitionShards(const CacheGeometry& geometry, int threads);
+
+//Simulates the whole trace on `shards` threads (a power of two from partitionShards) and
+//returns the merged counters
+CacheStats runPartitioned(TraceReader& trace, const CacheGeometry& geometry, ReplacementPolicy policy,
+    WritePolicy write_policy, WriteMissPolicy write_miss_policy, int shards);
@@ -0,0 +1,205 @@
+#include "Prefetcher.h"
+
+#include <iostream>
+
+bool parsePrefetcherKind(const std::string& name, PrefetcherKind& kind) {
+    std::string upper = toUpper(name);
+
+    const PrefetcherKind all[] = { PrefetcherKind::None, PrefetcherKind::NextLine, PrefetcherKind::Stride, PrefetcherKind::Stream };
+    for (PrefetcherKind candidate : all) {
+        if (upper == prefetcherKindName(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported prefetcher " << name << " (expected NONE, NEXT_LINE, STRIDE or STREAM)" << std::endl;
+    return false;
+}
+
+
+const char* prefetcherKindName(PrefetcherKind kind) {
+    switch (kind) {
+    case PrefetcherKind::None: return "NONE";
+    case PrefetcherKind::NextLine: return "NEXT_LINE";
+    case PrefetcherKind::Stride: return "STRIDE";
+    case PrefetcherKind::Stream: return "STREAM";
+    }
+    return "unknown";
+}
+
+
+bool readPrefetchConfig(const Config& config, const std::string& prefix, PrefetchConfig& prefetch) {
+    std::string kind;
+    if (config.has(prefix + "PREFETCHER") && (!config.read(prefix + "PREFETCHER", kind) || !parsePrefetcherKind(kind, prefetch.kind))) {
+        return false;
+    }
+
+    struct IntKey {
+        const char* name;
+        int* value;
+        int minimum;
+    };
+    IntKey keys[] = { { "PREFETCH_DEGREE", &prefetch.degree, 1 }, { "PREFETCH_STREAMS", &prefetch.streams, 1 },
+        { "PREFETCH_LATENCY", &prefetch.latency, 0 } };
+    for (const IntKey& key : keys) {
+        if (!config.read(prefix + key.name, *key.value)) {
+            return false;
+        }
+        if (*key.value < key.minimum) {
+            std::cerr << "Error: " << prefix << key.name << " must be at least " << key.minimum << "." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+namespace {
+
+class NextLinePrefetcher : public Prefetcher {
+public:
+    explicit NextLinePrefetcher(int degree) : degree_(degree) {}
+
+    void train(unsigned long long block, bool, std::vector<unsigned long long>& out) override {
+        for (int i = 1; i <= degree_; ++i) {
+            out.push_back(block + i);
+        }
+    }
+
+private:
+    int degree_;
+};
+
+
+class StridePrefetcher : public Prefetcher {
+public:
+    explicit StridePrefetcher(int degree) : degree_(degree), table_(TABLE_SIZE) {}
+
+    void train(unsigned long long block, bool, std::vector<unsigned long long>& out) override {
+        unsigned long long region = block >> REGION_BITS;
+        Entry& entry = table_[region & (TABLE_SIZE - 1)];
+        if (!entry.used || entry.region != region) {
+            //A new region (or a conflict in the table) starts over
+            entry.used = true;
+            entry.region = region;
+            entry.last_block = block;
+            entry.stride = 0;
+            entry.confident = false;
+            return;
+        }
+
+        long long delta = (long long)(block - entry.last_block);
+        if (delta == 0) {
+            return;
+        }
+        entry.confident = (delta == entry.stride);
+        entry.stride = delta;
+        entry.last_block = block;
+        if (entry.confident) {
+            for (int i = 1; i <= degree_; ++i) {
+                out.push_back(block + (unsigned long long)(entry.stride * i));
+            }
+        }
+    }
+
+private:
+    static const int TABLE_SIZE = 64; //Power of two
+    static const int REGION_BITS = 6; //64 blocks, a 4 KB page of 64 byte blocks
+
+    struct Entry {
+        bool used = false;
+        bool confident = false; //The last two deltas matched
+        unsigned long long region = 0;
+        unsigned long long last_block = 0;
+        long long stride = 0;
+    };
+
+    int degree_;
+    std::vector<Entry> table_;
+};
+
+
+class StreamPrefetcher : public Prefetcher {
+public:
+    StreamPrefetcher(int degree, int streams) : degree_(degree), streams_(streams), clock_(0) {}
+
+    void train(unsigned long long block, bool, std::vector<unsigned long long>& out) override {
+        clock_++;
+
+        //1. A block just ahead of a running stream continues it
+        for (Stream& stream : streams_) {
+            if (stream.direction != 0 && ahead(stream, block) > 0 && ahead(stream, block) <= degree_ + 1) {
+                stream.last_block = block;
+                stream.last_used = clock_;
+                runAhead(stream, out);
+                return;
+            }
+        }
+
+        //2. A block next to a new stream's first one gives it its direction
+        for (Stream& stream : streams_) {
+            if (stream.direction == 0 && stream.last_used != 0 && (block == stream.last_block + 1 || block == stream.last_block - 1)) {
+                stream.direction = (block == stream.last_block + 1) ? 1 : -1;
+                stream.last_block = block;
+                stream.frontier = block;
+                stream.last_used = clock_;
+                runAhead(stream, out);
+                return;
+            }
+        }
+
+        //3. Otherwise start tracking a new stream in the least recently used slot
+        Stream* oldest = &streams_[0];
+        for (Stream& stream : streams_) {
+            if (stream.last_used < oldest->last_used) {
+                oldest = &stream;
+            }
+        }
+        oldest->direction = 0;
+        oldest->last_block = block;
+        oldest->frontier = block;
+        oldest->last_used = clock_;
+    }
+
+private:
+    struct Stream {
+        int direction = 0; //+1 or -1 once trained
+        unsigned long long last_block = 0; //Last demanded block of the stream
+        unsigned long long frontier = 0; //Last block prefetched for it
+        unsigned long long last_used = 0; //0 for a free slot
+    };
+
+    //How many blocks block is past the stream's last one, in its direction
+    static long long ahead(const Stream& stream, unsigned long long block) {
+        return (long long)(block - stream.last_block) * stream.direction;
+    }
+
+    //Prefetches what is missing up to degree_ blocks past the stream's last block
+    void runAhead(Stream& stream, std::vector<unsigned long long>& out) {
+        if (ahead(stream, stream.frontier) < 0) {
+            stream.frontier = stream.last_block;
+        }
+        while (ahead(stream, stream.frontier) < degree_) {
+            stream.frontier += (unsigned long long)(long long)stream.direction;
+            out.push_back(stream.frontier);
+        }
+    }
+
+    int degree_;
+    std::vector<Stream> streams_;
+    unsigned long long clock_;
+};
+
+} // namespace
+
+
+std::unique_ptr<Prefetcher> makePrefetcher(const PrefetchConfig& config) {
+    switch (config.kind) {
+    case PrefetcherKind::None: return nullptr;
+    case PrefetcherKind::NextLine: return std::unique_ptr<Prefetcher>(new NextLinePrefetcher(config.degree));
+    case PrefetcherKind::Stride: return std::unique_ptr<Prefetcher>(new StridePrefetcher(config.degree));
+    case PrefetcherKind::Stream: return std::unique_ptr<Prefetcher>(new StreamPrefetcher(config.degree, config.streams));
+    }
+    return nullptr;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+
+//Hardware prefetcher models, driven from a Cache's miss path.
+//
+//A prefetcher sees the block number (address >> offset bits) of every demand miss and of
+//the first demand hit to a block it prefetched (tagged prefetching, so a stream it
+//covers keeps it running) and names the blocks to bring in. The cache fills those that
+//are not already cached like misses, marked as prefetched, see Cache::enablePrefetching.
+//  NEXT_LINE  the next PREFETCH_DEGREE blocks
+//  STRIDE     a table of 64 regions of 64 blocks, each learning the delta between its
+//             accesses (no PC is traced). Once a delta repeats, PREFETCH_DEGREE blocks
+//             along it are fetched.
+//  STREAM     PREFETCH_STREAMS stream trackers, each following one ascending or
+//             descending run of blocks and staying PREFETCH_DEGREE blocks ahead of it
+//             (stream buffers, but filling the cache itself)
+
+enum class PrefetcherKind {
+    None,
+    NextLine,
+    Stride,
+    Stream
+};
+
+//Accepts NONE, NEXT_LINE, STRIDE and STREAM in any case.
+//Prints an error and returns false for anything else.
+bool parsePrefetcherKind(const std::string& name, PrefetcherKind& kind);
+
+const char* prefetcherKindName(PrefetcherKind kind);
+
+struct PrefetchConfig {
+    PrefetcherKind kind = PrefetcherKind::None;
+    int degree = 1; //Blocks fetched per trigger, or how far a stream runs ahead
+    int streams = 8; //STREAM only
+    //The trace has no timing, so a prefetch counts as late when its block is demanded
+    //within this many accesses of the cache after being issued
+    int latency = 16;
+};
+
+//Reads prefix + PREFETCHER, PREFETCH_DEGREE, PREFETCH_STREAMS and PREFETCH_LATENCY,
+//leaving the defaults for missing keys.
+//Prints an error and returns false for a bad value.
+bool readPrefetchConfig(const Config& config, const std::string& prefix, PrefetchConfig& prefetch);
+
+
+class Prefetcher {
+public:
+    virtual ~Prefetcher() {}
+
+    //Called for a demand miss (miss = true) or the first demand hit to a prefetched block.
+    //Appends the blocks to prefetch to out.
+    virtual void train(unsigned long long block, bool miss, std::vector<unsigned long long>& out) = 0;
+};
+
+//nullptr for PrefetcherKind::None
+std::unique_ptr<Prefetcher> makePrefetcher(const PrefetchConfig& config);
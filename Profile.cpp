@@ -0,0 +1,186 @@
+#include "Profile.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "Config.h"
+
+namespace {
+
+//Opens filename for writing, printing an error if it cannot be created
+bool openOutput(const std::string& filename, std::ofstream& file) {
+    file.open(filename);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not create " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool closeOutput(const std::string& filename, std::ofstream& file) {
+    file.close();
+    if (!file) {
+        std::cerr << "Error: Failed writing " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+bool parseProfileFormat(const std::string& name, ProfileFormat& format) {
+    std::string upper = toUpper(name);
+    const ProfileFormat all[] = { ProfileFormat::Json, ProfileFormat::Csv };
+    for (ProfileFormat candidate : all) {
+        if (upper == profileFormatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported profile format " << name << " (expected JSON or CSV)" << std::endl;
+    return false;
+}
+
+
+const char* profileFormatName(ProfileFormat format) {
+    switch (format) {
+    case ProfileFormat::Json: return "JSON";
+    case ProfileFormat::Csv: return "CSV";
+    }
+    return "unknown";
+}
+
+
+CacheProfile::CacheProfile(int num_sets, int offset_bits, int top_evicted)
+    : set_index_(num_sets), offset_bits_(offset_bits), top_evicted_(top_evicted), set_hits_(num_sets, 0),
+      set_misses_(num_sets, 0), set_evictions_(num_sets, 0), reuse_(num_sets, 1 << offset_bits) {}
+
+
+void CacheProfile::resetCounts() {
+    std::fill(set_hits_.begin(), set_hits_.end(), 0);
+    std::fill(set_misses_.begin(), set_misses_.end(), 0);
+    std::fill(set_evictions_.begin(), set_evictions_.end(), 0);
+    reuse_.resetCurve();
+    evicted_blocks_.clear();
+}
+
+
+std::vector<CacheProfile::ReuseBucket> CacheProfile::reuseHistogram() const {
+    //Bucket 0 is distance 0, bucket k > 0 holds distances 2^(k-1) to 2^k - 1
+    const std::vector<long long>& counts = reuse_.curve().distance_counts;
+    std::vector<ReuseBucket> buckets;
+    for (std::size_t distance = 0; distance < counts.size(); ++distance) {
+        if (distance == 0 || (distance & (distance - 1)) == 0) {
+            ReuseBucket bucket = { (long long)distance, (distance == 0) ? 0 : 2 * (long long)distance - 1, 0 };
+            buckets.push_back(bucket);
+        }
+        buckets.back().accesses += counts[distance];
+    }
+    return buckets;
+}
+
+
+std::vector<CacheProfile::EvictedBlock> CacheProfile::topEvicted() const {
+    std::vector<EvictedBlock> blocks;
+    blocks.reserve(evicted_blocks_.size());
+    for (const std::pair<const unsigned long long, long long>& entry : evicted_blocks_) {
+        EvictedBlock block = { entry.first, entry.second };
+        blocks.push_back(block);
+    }
+    std::size_t count = std::min(blocks.size(), (std::size_t)top_evicted_);
+    std::partial_sort(blocks.begin(), blocks.begin() + count, blocks.end(), [](const EvictedBlock& a, const EvictedBlock& b) {
+        return (a.evictions != b.evictions) ? a.evictions > b.evictions : a.address < b.address;
+    });
+    blocks.resize(count);
+    return blocks;
+}
+
+
+bool CacheProfile::write(const std::string& filename, ProfileFormat format) const {
+    return (format == ProfileFormat::Json) ? writeJson(filename) : writeCsv(filename);
+}
+
+
+bool CacheProfile::writeJson(const std::string& filename) const {
+    std::ofstream file;
+    if (!openOutput(filename, file)) {
+        return false;
+    }
+
+    //1. Per-set counters, one array each so a heatmap can be drawn straight from them
+    const std::vector<long long>* counters[] = { &set_hits_, &set_misses_, &set_evictions_ };
+    const char* names[] = { "hits", "misses", "evictions" };
+    file << "{\n  \"num_sets\": " << set_hits_.size() << ",\n  \"block_size\": " << (1 << offset_bits_) << ",\n  \"sets\": {\n";
+    for (int c = 0; c < 3; ++c) {
+        file << "    \"" << names[c] << "\": [";
+        for (std::size_t set = 0; set < counters[c]->size(); ++set) {
+            file << (set ? ", " : "") << (*counters[c])[set];
+        }
+        file << "]" << ((c < 2) ? "," : "") << "\n";
+    }
+
+    //2. Reuse distances
+    std::vector<ReuseBucket> buckets = reuseHistogram();
+    file << "  },\n  \"reuse_distance\": {\n    \"first_touches\": " << reuse_.curve().cold_misses << ",\n    \"buckets\": [\n";
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        file << "      { \"min\": " << buckets[i].min_distance << ", \"max\": " << buckets[i].max_distance
+            << ", \"accesses\": " << buckets[i].accesses << " }" << ((i + 1 < buckets.size()) ? "," : "") << "\n";
+    }
+
+    //3. Most evicted blocks, addresses as hex strings since JSON numbers are doubles
+    std::vector<EvictedBlock> evicted = topEvicted();
+    file << "    ]\n  },\n  \"top_evicted\": [\n";
+    for (std::size_t i = 0; i < evicted.size(); ++i) {
+        unsigned long long set, tag;
+        set_index_.split(evicted[i].address >> offset_bits_, set, tag);
+        file << "    { \"address\": \"0x" << std::hex << evicted[i].address << "\", \"tag\": \"0x" << tag
+            << std::dec << "\", \"set\": " << set << ", \"evictions\": " << evicted[i].evictions
+            << " }" << ((i + 1 < evicted.size()) ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return closeOutput(filename, file);
+}
+
+
+bool CacheProfile::writeCsv(const std::string& prefix) const {
+    std::ofstream file;
+    std::string filename = prefix + "_sets.csv";
+    if (!openOutput(filename, file)) {
+        return false;
+    }
+    file << "set,hits,misses,evictions\n";
+    for (std::size_t set = 0; set < set_hits_.size(); ++set) {
+        file << set << "," << set_hits_[set] << "," << set_misses_[set] << "," << set_evictions_[set] << "\n";
+    }
+    if (!closeOutput(filename, file)) {
+        return false;
+    }
+
+    //First touches have no distance, they get their own line with empty bounds
+    filename = prefix + "_reuse.csv";
+    if (!openOutput(filename, file)) {
+        return false;
+    }
+    file << "min_distance,max_distance,accesses\n";
+    for (const ReuseBucket& bucket : reuseHistogram()) {
+        file << bucket.min_distance << "," << bucket.max_distance << "," << bucket.accesses << "\n";
+    }
+    file << ",," << reuse_.curve().cold_misses << "\n";
+    if (!closeOutput(filename, file)) {
+        return false;
+    }
+
+    filename = prefix + "_evicted.csv";
+    if (!openOutput(filename, file)) {
+        return false;
+    }
+    file << "address,tag,set,evictions\n";
+    for (const EvictedBlock& evicted : topEvicted()) {
+        unsigned long long set, tag;
+        set_index_.split(evicted.address >> offset_bits_, set, tag);
+        file << "0x" << std::hex << evicted.address << ",0x" << tag << std::dec << "," << set << "," << evicted.evictions << "\n";
+    }
+    return closeOutput(filename, file);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SetIndex.h"
+#include "StackDistance.h"
+
+//Where the misses of one cache come from, set by set.
+//
+//A CacheProfile counts the demand hits and misses and the evictions of every set, keeps a
+//histogram of reuse distances (the LRU stack distance within the set, see StackDistance.h,
+//in power-of-two buckets) and counts the evictions of every block to list the most evicted
+//ones. A set with many misses and short reuse distances is a conflict hot spot.
+//
+//The hooks in the Cache engine are only compiled in when CACHESIM_PROFILE is defined (for
+//every file, it changes the layout of Cache), so the default build does not pay for them.
+
+enum class ProfileFormat {
+    Json, //One file with everything
+    Csv //FILE_sets.csv, FILE_reuse.csv and FILE_evicted.csv
+};
+
+//Accepts JSON and CSV in any case.
+//Prints an error and returns false for anything else.
+bool parseProfileFormat(const std::string& name, ProfileFormat& format);
+
+const char* profileFormatName(ProfileFormat format);
+
+
+class CacheProfile {
+public:
+    //num_sets and offset_bits as in CacheGeometry, top_evicted is how many blocks to list
+    CacheProfile(int num_sets, int offset_bits, int top_evicted);
+
+    //A demand access to set index
+    void access(unsigned long long address, unsigned long long index, bool hit) {
+        ++(hit ? set_hits_ : set_misses_)[(std::size_t)index];
+        reuse_.accessInSet(address >> offset_bits_, (std::size_t)index);
+    }
+
+    //The block at address (its first byte) was evicted from set index
+    void evict(unsigned long long index, unsigned long long address) {
+        set_evictions_[(std::size_t)index]++;
+        evicted_blocks_[address]++;
+    }
+
+    //Zeroes the counts, keeping the reuse history (see Cache::resetStats)
+    void resetCounts();
+
+    //Writes the profile as format to filename (the prefix of the three CSV files).
+    //Returns false (after printing an error) if a file cannot be written.
+    bool write(const std::string& filename, ProfileFormat format) const;
+
+private:
+    //One bucket of the reuse distance histogram: distances in [min_distance, max_distance]
+    struct ReuseBucket {
+        long long min_distance;
+        long long max_distance;
+        long long accesses;
+    };
+
+    struct EvictedBlock {
+        unsigned long long address;
+        long long evictions;
+    };
+
+    std::vector<ReuseBucket> reuseHistogram() const;
+
+    //The top_evicted_ most evicted blocks, most first (lowest address first on ties)
+    std::vector<EvictedBlock> topEvicted() const;
+
+    bool writeJson(const std::string& filename) const;
+    bool writeCsv(const std::string& prefix) const;
+
+    ModuloIndex set_index_; //Only to print the tag and set of a block
+    int offset_bits_;
+    int top_evicted_;
+    std::vector<long long> set_hits_;
+    std::vector<long long> set_misses_;
+    std::vector<long long> set_evictions_;
+    StackDistanceAnalyzer reuse_;
+    std::unordered_map<unsigned long long, long long> evicted_blocks_;
+};
@@ -0,0 +1,164 @@
+#include "Progress.h"
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+#include "Bits.h"
+#include "Config.h"
+
+namespace {
+
+//"1h 02m 03s", "2m 03s" or "3s"
+std::string formatDuration(double seconds) {
+    long long total = (long long)(seconds + 0.5);
+    std::ostringstream out;
+    if (total >= 3600) {
+        out << total / 3600 << "h " << std::setw(2) << std::setfill('0') << (total / 60) % 60 << "m "
+            << std::setw(2) << total % 60 << "s";
+    }
+    else if (total >= 60) {
+        out << total / 60 << "m " << std::setw(2) << std::setfill('0') << total % 60 << "s";
+    }
+    else {
+        out << total << "s";
+    }
+    return out.str();
+}
+
+} // namespace
+
+
+bool parseIntervalFormat(const std::string& name, IntervalFormat& format) {
+    std::string upper = toUpper(name);
+    const IntervalFormat all[] = { IntervalFormat::Csv, IntervalFormat::Binary };
+    for (IntervalFormat candidate : all) {
+        if (upper == intervalFormatName(candidate)) {
+            format = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported interval format " << name << " (expected CSV or BINARY)" << std::endl;
+    return false;
+}
+
+
+const char* intervalFormatName(IntervalFormat format) {
+    switch (format) {
+    case IntervalFormat::Csv: return "CSV";
+    case IntervalFormat::Binary: return "BINARY";
+    }
+    return "unknown";
+}
+
+
+bool IntervalLog::open(const std::string& filename) {
+    filename_ = filename;
+    file_.open(filename, (format_ == IntervalFormat::Binary) ? std::ios::out | std::ios::binary : std::ios::out);
+    if (!file_.is_open()) {
+        std::cerr << "Error: Could not create " << filename << std::endl;
+        return false;
+    }
+
+    if (format_ == IntervalFormat::Binary) {
+        unsigned char header[16];
+        for (int i = 0; i < 8; ++i) {
+            header[i] = (unsigned char)INTERVAL_MAGIC[i];
+        }
+        storeLittleEndian64(header + 8, (unsigned long long)interval_);
+        file_.write((const char*)header, sizeof(header));
+    }
+    else {
+        file_ << "accesses,hits,misses,hit_rate\n" << std::fixed << std::setprecision(6);
+    }
+    return true;
+}
+
+
+void IntervalLog::snapshot(long long accesses, long long hits, long long misses) {
+    long long interval_hits = hits - hits_;
+    long long interval_misses = misses - misses_;
+    if (format_ == IntervalFormat::Binary) {
+        unsigned char record[24];
+        storeLittleEndian64(record, (unsigned long long)accesses);
+        storeLittleEndian64(record + 8, (unsigned long long)interval_hits);
+        storeLittleEndian64(record + 16, (unsigned long long)interval_misses);
+        file_.write((const char*)record, sizeof(record));
+    }
+    else {
+        long long demand = interval_hits + interval_misses;
+        file_ << accesses << "," << interval_hits << "," << interval_misses << ","
+            << ((demand == 0) ? 0.0 : (double)interval_hits / demand) << "\n";
+    }
+    accesses_ = accesses;
+    hits_ = hits;
+    misses_ = misses;
+}
+
+
+bool IntervalLog::close(long long accesses, long long hits, long long misses) {
+    if (accesses > accesses_) {
+        snapshot(accesses, hits, misses);
+    }
+    file_.close();
+    if (!file_) {
+        std::cerr << "Error: Failed writing " << filename_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+ProgressMeter::ProgressMeter(double seconds, long long total_records, long long first_access)
+    : seconds_(seconds), total_records_(total_records), accesses_(first_access), hits_(0), misses_(0), stop_(false) {
+    thread_ = std::thread(&ProgressMeter::run, this);
+}
+
+
+ProgressMeter::~ProgressMeter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+
+void ProgressMeter::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point last_time = start;
+    long long last_accesses = accesses_.load(std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, std::chrono::duration<double>(seconds_), [this] { return stop_; })) {
+        long long accesses = accesses_.load(std::memory_order_relaxed);
+        long long hits = hits_.load(std::memory_order_relaxed);
+        long long demand = hits + misses_.load(std::memory_order_relaxed);
+        Clock::time_point now = Clock::now();
+
+        //The rate since the last line, so it follows the phases of the trace
+        double elapsed = std::chrono::duration<double>(now - last_time).count();
+        double rate = (elapsed > 0.0) ? (accesses - last_accesses) / elapsed : 0.0;
+        last_time = now;
+        last_accesses = accesses;
+
+        std::ostringstream line;
+        line << std::fixed << "Progress: " << accesses;
+        if (total_records_ > 0) {
+            line << " of " << total_records_ << " accesses (" << std::setprecision(1) << (100.0 * accesses / total_records_) << "%)";
+        }
+        else {
+            line << " accesses";
+        }
+        line << ", " << std::setprecision(2) << (rate / 1e6) << "M accesses/s, hit rate "
+            << ((demand == 0) ? 0.0 : 100.0 * hits / demand) << "%";
+        if (total_records_ > 0 && rate > 0.0) {
+            line << ", ETA " << formatDuration((total_records_ - accesses) / rate);
+        }
+        line << ", elapsed " << formatDuration(std::chrono::duration<double>(now - start).count());
+        std::cerr << line.str() << std::endl;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//Visibility into long runs.
+//
+//An IntervalLog records the hits and misses of every INTERVAL_ACCESSES accesses as a time
+//series, to show phase behaviour. The simulation loop splits its batches at the interval
+//boundaries, so the snapshots are exact and the cache engine is not involved.
+//
+//A ProgressMeter prints a progress line every PROGRESS_SECONDS from a thread of its own.
+//The simulation loop publishes its totals once per batch with relaxed stores to atomics
+//only it writes, and the meter thread only loads them, so the hot path takes no locks and
+//issues no fences.
+
+enum class IntervalFormat {
+    Csv, //"accesses,hits,misses,hit_rate" per interval
+    Binary //See INTERVAL_MAGIC
+};
+
+//Accepts CSV and BINARY in any case.
+//Prints an error and returns false for anything else.
+bool parseIntervalFormat(const std::string& name, IntervalFormat& format);
+
+const char* intervalFormatName(IntervalFormat format);
+
+//Binary interval layout (all integers little-endian, 8 bytes each):
+//  magic "CSINTVL1", then the interval length in accesses
+//  then per interval: accesses so far at its end, its hits, its misses
+//The last interval is shorter if the trace ends inside it.
+const char INTERVAL_MAGIC[8] = { 'C', 'S', 'I', 'N', 'T', 'V', 'L', '1' };
+
+
+class IntervalLog {
+public:
+    IntervalLog(long long interval, IntervalFormat format) : interval_(interval), format_(format), accesses_(0), hits_(0), misses_(0) {}
+
+    //Prints an error and returns false if filename cannot be created
+    bool open(const std::string& filename);
+
+    long long interval() const { return interval_; }
+
+    //Starts the first interval at these totals instead of 0 (a run resumed part way through)
+    void start(long long accesses, long long hits, long long misses) {
+        accesses_ = accesses;
+        hits_ = hits;
+        misses_ = misses;
+    }
+
+    //Ends an interval, given the totals of the whole run so far
+    void snapshot(long long accesses, long long hits, long long misses);
+
+    //Ends the last, partial interval if there is one and closes the file.
+    //Prints an error and returns false if writing failed.
+    bool close(long long accesses, long long hits, long long misses);
+
+private:
+    long long interval_;
+    IntervalFormat format_;
+    std::ofstream file_;
+    std::string filename_;
+    long long accesses_; //Totals at the end of the last interval
+    long long hits_;
+    long long misses_;
+};
+
+
+class ProgressMeter {
+public:
+    //Prints to std::cerr every `seconds`. Without total_records (-1) there is no ETA.
+    //first_access is where in the trace the run starts.
+    ProgressMeter(double seconds, long long total_records, long long first_access = 0);
+
+    //Stops the thread
+    ~ProgressMeter();
+
+    ProgressMeter(const ProgressMeter&) = delete;
+    ProgressMeter& operator=(const ProgressMeter&) = delete;
+
+    //Called by the simulation loop only. accesses is the position in the trace, hits and
+    //misses are the counters, which leave out a warmup.
+    void update(long long accesses, long long hits, long long misses) {
+        accesses_.store(accesses, std::memory_order_relaxed);
+        hits_.store(hits, std::memory_order_relaxed);
+        misses_.store(misses, std::memory_order_relaxed);
+    }
+
+private:
+    //Runs on the meter thread
+    void run();
+
+    double seconds_;
+    long long total_records_;
+    std::atomic<long long> accesses_;
+    std::atomic<long long> hits_;
+    std::atomic<long long> misses_;
+    std::mutex mutex_; //Only for waking the thread up to stop
+    std::condition_variable wake_;
+    bool stop_;
+    std::thread thread_;
+};
@@ -0,0 +1,47 @@
+#include "ReplacementPolicy.h"
+
+#include <iostream>
+
+#include "Config.h"
+
+namespace {
+
+const ReplacementPolicy ALL_POLICIES[] = {
+    ReplacementPolicy::Lru,
+    ReplacementPolicy::TreePlru,
+    ReplacementPolicy::Srrip,
+    ReplacementPolicy::Brrip,
+    ReplacementPolicy::Fifo,
+    ReplacementPolicy::Random
+};
+
+} // namespace
+
+
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy) {
+    std::string upper = toUpper(name);
+
+    for (ReplacementPolicy candidate : ALL_POLICIES) {
+        if (upper == replacementPolicyName(candidate)) {
+            policy = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported replacement policy " << name
+        << " (expected LRU, PLRU, SRRIP, BRRIP, FIFO or RANDOM)" << std::endl;
+    return false;
+}
+
+
+const char* replacementPolicyName(ReplacementPolicy policy) {
+    switch (policy) {
+    case ReplacementPolicy::Lru: return "LRU";
+    case ReplacementPolicy::TreePlru: return "PLRU";
+    case ReplacementPolicy::Srrip: return "SRRIP";
+    case ReplacementPolicy::Brrip: return "BRRIP";
+    case ReplacementPolicy::Fifo: return "FIFO";
+    case ReplacementPolicy::Random: return "RANDOM";
+    }
+    return "unknown";
+}
@@ -0,0 +1,410 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Bits.h"
+#include "Checkpoint.h"
+
+//Replacement policies.
+//
+//A policy owns the per-set state it needs and is plugged into the Cache engine as a
+//template argument, so its hooks are inlined into the access kernel. Every policy has:
+//  init(sets, ways)        sizes the state for an empty cache
+//  onHit(set, way, ways)   a resident block was used
+//  onFill(set, way, ways)  a new block was placed in way (a free way or the victim's)
+//  victim(set, ways)       picks the way to evict from a full set
+//  prefetch(set, ways)     starts loading the set's state, for batches that look ahead
+//  checkpoint(file)        saves or restores the state after init (see Checkpoint.h)
+//ways is passed on every call so the specialized engines can turn it into a constant.
+//Free ways are always filled lowest first (CacheStorage::findInvalidWay) before victim
+//is ever asked for.
+
+enum class ReplacementPolicy {
+    Lru,
+    TreePlru,
+    Srrip,
+    Brrip,
+    Fifo,
+    Random
+};
+
+//Accepts LRU, PLRU, SRRIP, BRRIP, FIFO and RANDOM, in any case.
+//Prints an error and returns false for anything else.
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy);
+
+const char* replacementPolicyName(ReplacementPolicy policy);
+
+
+//Exact LRU without timestamps, so it stays exact however long the trace is.
+//
+//Up to 256 ways every block holds its age rank in one byte (0 = most recent, ways-1 =
+//least recent). A use moves the way to rank 0 and ages every younger block by one, which
+//is a branch-free loop over the set that the compiler vectorizes, and the victim is the
+//single way at rank ways-1. Wider sets keep a move-to-front doubly linked list per set
+//instead, where a use and the victim are O(1).
+//Each set starts with way i at rank i. Free ways are filled lowest first, so by the time
+//the set is full every way has been used and the ranks are the true recency order.
+class LruPolicy {
+public:
+    static const int MAX_RANKED_WAYS = 256;
+
+    void init(int sets, int ways) {
+        if (ways <= MAX_RANKED_WAYS) {
+            rank_.resize((std::size_t)sets * ways);
+            for (std::size_t block = 0; block < rank_.size(); ++block) {
+                rank_[block] = (unsigned char)(block % ways);
+            }
+            return;
+        }
+
+        //Way i is initially followed by way i + 1, from head (MRU) to tail (LRU)
+        prev_.resize((std::size_t)sets * ways);
+        next_.resize((std::size_t)sets * ways);
+        for (std::size_t block = 0; block < prev_.size(); ++block) {
+            unsigned int way = (unsigned int)(block % ways);
+            prev_[block] = way - 1;
+            next_[block] = way + 1;
+        }
+        head_.assign((std::size_t)sets, 0);
+        tail_.assign((std::size_t)sets, (unsigned int)ways - 1);
+    }
+
+    void onHit(unsigned long long set, int way, int ways) {
+        touch(set, way, ways);
+    }
+
+    void onFill(unsigned long long set, int way, int ways) {
+        touch(set, way, ways);
+    }
+
+    int victim(unsigned long long set, int ways) const {
+        if (ways > MAX_RANKED_WAYS) {
+            return (int)tail_[set];
+        }
+
+        //Exactly one way holds the oldest rank
+        const unsigned char* rank = rank_.data() + set * ways;
+        const unsigned char oldest = (unsigned char)(ways - 1);
+        int victim_way = 0;
+        for (int i = 0; i < ways; ++i) {
+            victim_way |= (rank[i] == oldest) ? i : 0;
+        }
+        return victim_way;
+    }
+
+    void prefetch(unsigned long long set, int ways) const {
+        if (ways <= MAX_RANKED_WAYS) {
+            prefetchRead(rank_.data() + set * ways);
+        }
+        else {
+            prefetchRead(head_.data() + set);
+        }
+    }
+
+    void checkpoint(CheckpointFile& file) {
+        file.items(rank_);
+        file.items(prev_);
+        file.items(next_);
+        file.items(head_);
+        file.items(tail_);
+    }
+
+private:
+    void touch(unsigned long long set, int way, int ways) {
+        if (ways <= MAX_RANKED_WAYS) {
+            unsigned char* rank = rank_.data() + set * ways;
+            const unsigned char used = rank[way];
+            for (int i = 0; i < ways; ++i) {
+                rank[i] += (rank[i] < used);
+            }
+            rank[way] = 0;
+            return;
+        }
+
+        //Move the way to the front of its set's list
+        unsigned int* prev = prev_.data() + set * ways;
+        unsigned int* next = next_.data() + set * ways;
+        unsigned int head = head_[set];
+        if ((unsigned int)way == head) {
+            return;
+        }
+        if ((unsigned int)way == tail_[set]) {
+            tail_[set] = prev[way];
+        }
+        else {
+            prev[next[way]] = prev[way];
+        }
+        next[prev[way]] = next[way];
+        next[way] = head;
+        prev[head] = (unsigned int)way;
+        head_[set] = (unsigned int)way;
+    }
+
+    std::vector<unsigned char> rank_; //Age rank per block, up to MAX_RANKED_WAYS ways
+    //Move-to-front order for wider sets, as way numbers within the set
+    std::vector<unsigned int> prev_;
+    std::vector<unsigned int> next_;
+    std::vector<unsigned int> head_; //Most recently used way per set
+    std::vector<unsigned int> tail_; //Least recently used way per set
+};
+
+
+//Tree pseudo-LRU: a binary tree of ways-1 bits per set (heap-ordered, node 1 is the root).
+//Each bit points at the half of its subtree that was used less recently. A use flips the
+//bits on the way's path to point away from it, and the victim is found by following them.
+//Up to 64 ways the tree is one word and a use is a single and/or with precomputed path
+//masks; the victim walk takes log2(ways) branch-free steps. Ways that are not a power of
+//two get a tree over the next power of two whose missing leaves are never chosen.
+class TreePlruPolicy {
+public:
+    void init(int sets, int ways) {
+        leaves_ = 1;
+        while (leaves_ < ways) {
+            leaves_ *= 2;
+        }
+        words_ = (leaves_ + 63) / 64;
+        bits_.assign((std::size_t)sets * words_, 0);
+
+        //Path masks of every way for one-word trees: the bits its use clears and sets
+        path_clear_.assign(leaves_, 0);
+        path_set_.assign(leaves_, 0);
+        if (words_ == 1) {
+            for (int way = 0; way < leaves_; ++way) {
+                for (int node = leaves_ + way; node > 1; node >>= 1) {
+                    unsigned long long bit = 1ULL << (node >> 1);
+                    path_clear_[way] |= bit;
+                    path_set_[way] |= (node & 1) ? 0 : bit;
+                }
+            }
+        }
+    }
+
+    void onHit(unsigned long long set, int way, int ways) {
+        touch(set, way);
+        (void)ways;
+    }
+
+    void onFill(unsigned long long set, int way, int ways) {
+        touch(set, way);
+        (void)ways;
+    }
+
+    int victim(unsigned long long set, int ways) const {
+        const unsigned long long* tree = bits_.data() + set * words_;
+        int node = 1;
+        int first = 0; //First way under node
+        for (int span = leaves_; span > 1; span /= 2) {
+            int half = span / 2;
+            //The right half of the last subtree may be past the real ways
+            int right = (int)((tree[node >> 6] >> (node & 63)) & 1) & (first + half < ways);
+            first += right * half;
+            node = 2 * node + right;
+        }
+        return first;
+    }
+
+    void prefetch(unsigned long long set, int ways) const {
+        prefetchRead(bits_.data() + set * words_);
+        (void)ways;
+    }
+
+    //The path masks follow from the geometry
+    void checkpoint(CheckpointFile& file) {
+        file.items(bits_);
+    }
+
+private:
+    void touch(unsigned long long set, int way) {
+        unsigned long long* tree = bits_.data() + set * words_;
+        if (words_ == 1) {
+            tree[0] = (tree[0] & ~path_clear_[way]) | path_set_[way];
+            return;
+        }
+        for (int node = leaves_ + way; node > 1; node >>= 1) {
+            int parent = node >> 1;
+            //Point the parent at the sibling: right (1) if we came from the left child
+            unsigned long long bit = 1ULL << (parent & 63);
+            if (node & 1) {
+                tree[parent >> 6] &= ~bit;
+            }
+            else {
+                tree[parent >> 6] |= bit;
+            }
+        }
+    }
+
+    std::vector<unsigned long long> bits_;
+    std::vector<unsigned long long> path_clear_;
+    std::vector<unsigned long long> path_set_;
+    int leaves_ = 1;
+    int words_ = 1; //Tree words per set
+};
+
+
+//Static/bimodal re-reference interval prediction (Jaleel et al., ISCA 2010) with 2-bit
+//RRPVs. The RRPVs of a set are stored as two bit planes per group of 64 ways, so finding
+//the first way at the maximum RRPV and ageing the whole set are a handful of word
+//operations. A hit sets the RRPV to 0. SRRIP inserts at 2; BRRIP inserts at 3 and only
+//every 32nd fill at 2.
+template <bool BIMODAL>
+class RripPolicy {
+public:
+    void init(int sets, int ways) {
+        groups_ = (ways + 63) / 64;
+        fills_ = 0;
+        planes_.assign((std::size_t)sets * groups_ * 2, 0);
+    }
+
+    void onHit(unsigned long long set, int way, int ways) {
+        unsigned long long* plane = setPlanes(set) + 2 * (way >> 6);
+        unsigned long long bit = 1ULL << (way & 63);
+        plane[0] &= ~bit;
+        plane[1] &= ~bit;
+        (void)ways;
+    }
+
+    void onFill(unsigned long long set, int way, int ways) {
+        unsigned long long* plane = setPlanes(set) + 2 * (way >> 6);
+        unsigned long long bit = 1ULL << (way & 63);
+        bool distant = BIMODAL && (fills_++ & 31) != 0;
+        //RRPV 3 = both bits set, 2 = high bit only
+        plane[0] = distant ? (plane[0] | bit) : (plane[0] & ~bit);
+        plane[1] |= bit;
+        (void)ways;
+    }
+
+    //The first way with RRPV 3. If there is none, every RRPV is aged by the amount that
+    //brings the largest one to 3, which is what repeatedly incrementing them all does.
+    int victim(unsigned long long set, int ways) {
+        unsigned long long* planes = setPlanes(set);
+
+        //Largest RRPV in the set, and the first way holding it
+        int max_rrpv = -1;
+        int victim_way = 0;
+        for (int group = 0; group < groups_; ++group) {
+            unsigned long long low = planes[2 * group];
+            unsigned long long high = planes[2 * group + 1];
+            unsigned long long lanes = laneMask(group, ways);
+            unsigned long long at_level[4] = { ~high & ~low & lanes, ~high & low & lanes, high & ~low & lanes, high & low & lanes };
+            for (int rrpv = 3; rrpv > max_rrpv; --rrpv) {
+                if (at_level[rrpv] != 0) {
+                    max_rrpv = rrpv;
+                    victim_way = group * 64 + countTrailingZeros(at_level[rrpv]);
+                    break;
+                }
+            }
+        }
+
+        //Age the set: add (3 - max) to every 2-bit lane, no lane can overflow
+        int age = 3 - max_rrpv;
+        if (age > 0) {
+            unsigned long long add_low = (age & 1) ? ~0ULL : 0;
+            unsigned long long add_high = (age & 2) ? ~0ULL : 0;
+            for (int group = 0; group < groups_; ++group) {
+                unsigned long long lanes = laneMask(group, ways);
+                unsigned long long low = planes[2 * group];
+                unsigned long long high = planes[2 * group + 1];
+                planes[2 * group] = (low ^ add_low) & lanes;
+                planes[2 * group + 1] = (high ^ add_high ^ (low & add_low)) & lanes;
+            }
+        }
+        return victim_way;
+    }
+
+    void prefetch(unsigned long long set, int ways) const {
+        prefetchRead(planes_.data() + set * groups_ * 2);
+        (void)ways;
+    }
+
+    void checkpoint(CheckpointFile& file) {
+        file.items(planes_);
+        file.value(fills_);
+    }
+
+private:
+    unsigned long long* setPlanes(unsigned long long set) {
+        return planes_.data() + set * groups_ * 2;
+    }
+
+    //Ways of this group that exist
+    static unsigned long long laneMask(int group, int ways) {
+        int lanes = ways - group * 64;
+        return (lanes >= 64) ? ~0ULL : (1ULL << lanes) - 1;
+    }
+
+    std::vector<unsigned long long> planes_; //Low and high RRPV bits per group of 64 ways
+    int groups_ = 1;
+    unsigned int fills_ = 0; //BRRIP throttle
+};
+
+typedef RripPolicy<false> SrripPolicy;
+typedef RripPolicy<true> BrripPolicy;
+
+
+//FIFO: the blocks of a set in the order they were filled. This is the LRU order with only
+//the fills counted, so it is kept by an LruPolicy that never sees the hits. A round-robin
+//pointer would not do: a way freed by an invalidation (a back-invalidation, a block moving
+//up from an exclusive level, a coherence invalidation) is refilled out of turn, and the
+//pointer would then evict the newest block.
+class FifoPolicy {
+public:
+    void init(int sets, int ways) {
+        order_.init(sets, ways);
+    }
+
+    void onHit(unsigned long long, int, int) {}
+
+    void onFill(unsigned long long set, int way, int ways) {
+        order_.onFill(set, way, ways);
+    }
+
+    int victim(unsigned long long set, int ways) const {
+        return order_.victim(set, ways);
+    }
+
+    void prefetch(unsigned long long set, int ways) const {
+        order_.prefetch(set, ways);
+    }
+
+    void checkpoint(CheckpointFile& file) {
+        order_.checkpoint(file);
+    }
+
+private:
+    LruPolicy order_;
+};
+
+
+//Random: no per-set state, victims come from a xorshift64* generator with a fixed seed so
+//that runs are repeatable
+class RandomPolicy {
+public:
+    void init(int sets, int ways) {
+        state_ = 0x9E3779B97F4A7C15ULL;
+        (void)sets;
+        (void)ways;
+    }
+
+    void onHit(unsigned long long, int, int) {}
+    void onFill(unsigned long long, int, int) {}
+
+    int victim(unsigned long long set, int ways) {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        unsigned long long random = state_ * 0x2545F4914F6CDD1DULL;
+        (void)set;
+        //Scale the top 32 bits into [0, ways) without a division
+        return (int)(((random >> 32) * (unsigned long long)ways) >> 32);
+    }
+
+    void prefetch(unsigned long long, int) const {}
+
+    void checkpoint(CheckpointFile& file) {
+        file.value(state_);
+    }
+
+private:
+    unsigned long long state_ = 0;
+};
@@ -0,0 +1,149 @@
+#include "Sampling.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+//Groups the sampled sets are split into for the confidence interval
+const int SAMPLE_GROUPS = 32;
+
+//Two-sided 95% quantile of the normal distribution
+const double CONFIDENCE_Z = 1.96;
+
+//splitmix64 finalizer, spreads set indices evenly over 64 bits
+unsigned long long hashSet(unsigned long long index) {
+    unsigned long long x = index + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+int log2Exact(int value) {
+    int bits = 0;
+    while ((1 << bits) < value) {
+        bits++;
+    }
+    return bits;
+}
+
+} // namespace
+
+
+CacheStats SampledStats::estimated() const {
+    CacheStats stats;
+    stats.hits = (long long)std::llround(hit_rate * total_accesses);
+    stats.misses = total_accesses - stats.hits;
+
+    double scale = (sampled.accesses() == 0) ? 0.0 : (double)total_accesses / sampled.accesses();
+    stats.fetches = (long long)std::llround(sampled.fetches * scale);
+    stats.writebacks = (long long)std::llround(sampled.writebacks * scale);
+    stats.write_throughs = (long long)std::llround(sampled.write_throughs * scale);
+    return stats;
+}
+
+
+int sampledSetCount(const CacheGeometry& geometry, double rate) {
+    //Keep 1 in 2^k sets, with 2^k the power of two closest to 1 / rate
+    int sample_bits = (int)std::lround(std::log2(1.0 / rate));
+    if (sample_bits < 0) {
+        sample_bits = 0;
+    }
+    if (sample_bits > geometry.index_bits) {
+        std::cerr << "Error: A sample rate of " << rate << " keeps less than one of the cache's "
+            << (1 << geometry.index_bits) << " sets." << std::endl;
+        return 0;
+    }
+    return 1 << (geometry.index_bits - sample_bits);
+}
+
+
+SampledStats runSampled(TraceReader& trace, const CacheGeometry& geometry, ReplacementPolicy policy,
+    WritePolicy write_policy, WriteMissPolicy write_miss_policy, int sampled_sets) {
+    const int indexed_sets = 1 << geometry.index_bits;
+    const int groups = (sampled_sets < SAMPLE_GROUPS) ? sampled_sets : SAMPLE_GROUPS;
+    const int group_bits = log2Exact(groups);
+
+    //1. Pick the sampled_sets sets with the smallest hashes and number them 0, 1, ...
+    std::vector<int> order(indexed_sets);
+    for (int set = 0; set < indexed_sets; ++set) {
+        order[set] = set;
+    }
+    std::nth_element(order.begin(), order.begin() + (sampled_sets - 1), order.end(), [](int a, int b) {
+        return hashSet((unsigned long long)a) < hashSet((unsigned long long)b);
+    });
+    std::sort(order.begin(), order.begin() + sampled_sets);
+    std::vector<int> sample_slot(indexed_sets, -1);
+    for (int i = 0; i < sampled_sets; ++i) {
+        sample_slot[order[i]] = i;
+    }
+
+    //2. Sample number i goes to group i % groups as set i / groups of that group's cache
+    CacheGeometry group_geometry = geometry;
+    group_geometry.index_bits = log2Exact(sampled_sets) - group_bits;
+    group_geometry.num_sets = 1 << group_geometry.index_bits;
+    group_geometry.cache_size = (long long)group_geometry.num_sets * geometry.associativity * geometry.block_size;
+
+    std::vector<Cache> caches;
+    caches.reserve(groups);
+    for (int group = 0; group < groups; ++group) {
+        caches.emplace_back(group_geometry, policy, write_policy, write_miss_policy);
+    }
+
+    //3. Filter every batch and hand each group its renumbered accesses
+    const int offset_bits = geometry.offset_bits;
+    const unsigned long long offset_mask = (1ULL << offset_bits) - 1;
+    const unsigned long long index_mask = (unsigned long long)indexed_sets - 1;
+    const int local_bits = group_geometry.index_bits;
+
+    SampledStats result;
+    std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+    std::vector<std::vector<TraceRecord>> routed(groups);
+    std::size_t batch_count;
+    while ((batch_count = trace.read(batch.data(), batch.size())) > 0) {
+        result.total_accesses += (long long)batch_count;
+        for (std::size_t i = 0; i < batch_count; ++i) {
+            unsigned long long address = batch[i].address;
+            unsigned long long block = address >> offset_bits;
+            int slot = sample_slot[block & index_mask];
+            if (slot < 0) {
+                continue;
+            }
+            unsigned long long tag = block >> geometry.index_bits;
+            unsigned long long local = (unsigned long long)(slot >> group_bits);
+            TraceRecord record;
+            record.address = ((((tag << local_bits) | local)) << offset_bits) | (address & offset_mask);
+            record.access_type = batch[i].access_type;
+            record.core = batch[i].core;
+            routed[slot & (groups - 1)].push_back(record);
+        }
+        for (int group = 0; group < groups; ++group) {
+            caches[group].access(routed[group].data(), routed[group].size());
+            routed[group].clear();
+        }
+    }
+
+    //4. Ratio estimate of the hit rate and its standard error over the groups
+    for (const Cache& cache : caches) {
+        result.sampled.add(cache.stats());
+    }
+    result.sampled_sets = sampled_sets;
+    result.total_sets = indexed_sets;
+    result.hit_rate = result.sampled.hitRate();
+
+    if (groups >= 2 && result.sampled.accesses() > 0) {
+        double mean_accesses = (double)result.sampled.accesses() / groups;
+        double residuals = 0.0;
+        for (const Cache& cache : caches) {
+            double residual = cache.stats().hits - result.hit_rate * cache.stats().accesses();
+            residuals += residual * residual;
+        }
+        //Finite population correction: the sample is a fraction of all sets
+        double kept = (double)sampled_sets / indexed_sets;
+        double variance = (1.0 - kept) * residuals / ((double)groups * (groups - 1) * mean_accesses * mean_accesses);
+        result.half_width = CONFIDENCE_Z * std::sqrt(variance);
+    }
+    return result;
+}
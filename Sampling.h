@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Cache.h"
+#include "ReplacementPolicy.h"
+#include "Trace.h"
+
+//Set-sampled simulation of one cache, for quick estimates on very large traces.
+//
+//Sets never interact, so simulating a random subset of them exactly and scaling up gives
+//an unbiased estimate of the hit rate. A hash of the set index picks 1 in 2^k sets (the
+//sample rate rounded to a power of two). The sampled sets are dealt round-robin into
+//independent groups, each an ordinary Cache with fewer sets fed renumbered addresses like
+//a shard of Partition.h. The spread of the per-group hit rates gives a confidence interval
+//for the estimate (ratio estimator over cluster samples).
+
+//Result of a sampled run
+struct SampledStats {
+    long long total_accesses = 0; //Every access of the trace, sampled or not
+    CacheStats sampled; //Counters of the simulated sets only
+    int sampled_sets = 0;
+    int total_sets = 0;
+    double hit_rate = 0.0; //Estimated hit rate of the whole cache
+    double half_width = 0.0; //Of the 95% confidence interval, 0 if there are too few groups
+
+    //Counters of the whole cache, scaled from the sample (the traffic counters in proportion
+    //to the accesses)
+    CacheStats estimated() const;
+};
+
+//Number of sets kept when sampling geometry at about `rate` (0 < rate < 1).
+//Prints an error and returns 0 if the cache has too few sets for the rate.
+int sampledSetCount(const CacheGeometry& geometry, double rate);
+
+//Simulates sampled_sets of the cache's sets (from sampledSetCount) over the whole trace
+SampledStats runSampled(TraceReader& trace, const CacheGeometry& geometry, ReplacementPolicy policy,
+    WritePolicy write_policy, WriteMissPolicy write_miss_policy, int sampled_sets);
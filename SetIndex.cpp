@@ -0,0 +1,138 @@
+#include "SetIndex.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+//splitmix64 finalizer, for the per-way multipliers of a skewed index
+unsigned long long mixWay(unsigned long long way) {
+    unsigned long long x = way + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+//Parses one mask, hex with a 0x prefix or decimal
+bool parseMask(const std::string& text, unsigned long long& mask) {
+    bool hex = text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X');
+    const char* digits = text.c_str() + (hex ? 2 : 0);
+    if (!std::isxdigit((unsigned char)digits[0])) {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    mask = std::strtoull(digits, &end, hex ? 16 : 10);
+    return errno == 0 && *end == '\0';
+}
+
+} // namespace
+
+
+bool parseIndexFunction(const std::string& name, IndexFunction& function) {
+    std::string upper = toUpper(name);
+    const IndexFunction all[] = { IndexFunction::Modulo, IndexFunction::XorFold, IndexFunction::HashMatrix, IndexFunction::Skewed };
+    for (IndexFunction candidate : all) {
+        if (upper == indexFunctionName(candidate)) {
+            function = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported index function " << name << " (expected MODULO, XOR_FOLD, HASH_MATRIX or SKEWED)" << std::endl;
+    return false;
+}
+
+
+const char* indexFunctionName(IndexFunction function) {
+    switch (function) {
+    case IndexFunction::Modulo: return "MODULO";
+    case IndexFunction::XorFold: return "XOR_FOLD";
+    case IndexFunction::HashMatrix: return "HASH_MATRIX";
+    case IndexFunction::Skewed: return "SKEWED";
+    }
+    return "unknown";
+}
+
+
+bool readIndexConfig(const Config& config, const std::string& prefix, IndexConfig& index) {
+    std::string name;
+    if (config.has(prefix + "INDEX_FUNCTION") && (!config.read(prefix + "INDEX_FUNCTION", name) || !parseIndexFunction(name, index.function))) {
+        return false;
+    }
+    const std::string key = prefix + "INDEX_HASH_MASKS";
+    if (index.function != IndexFunction::HashMatrix) {
+        if (config.has(key)) {
+            std::cerr << "Error: " << key << " needs " << prefix << "INDEX_FUNCTION HASH_MATRIX." << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::string masks;
+    if (!config.require(key) || !config.read(key, masks)) {
+        return false;
+    }
+    index.hash_masks.clear();
+    std::size_t start = 0;
+    while ((start = masks.find_first_not_of(", \t", start)) != std::string::npos) {
+        std::size_t end = masks.find_first_of(", \t", start);
+        std::string text = masks.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+        unsigned long long mask;
+        if (!parseMask(text, mask)) {
+            std::cerr << "Error: " << key << " must be masks in hex (0x...) or decimal, got '" << text << "'" << std::endl;
+            return false;
+        }
+        index.hash_masks.push_back(mask);
+        start = end;
+    }
+    return true;
+}
+
+
+HashMatrixIndex::HashMatrixIndex(const std::vector<unsigned long long>& masks)
+    : bits_((int)masks.size()), invertible_(true), masks_(), inverse_() {
+    if (bits_ > MAX_BITS) {
+        bits_ = 0;
+        invertible_ = false;
+        return;
+    }
+
+    //Gauss-Jordan elimination over GF(2) of the low bits of the masks, with every row
+    //operation repeated on the identity, which turns into the inverse
+    const unsigned long long low_mask = (1ULL << bits_) - 1;
+    unsigned long long rows[MAX_BITS];
+    for (int bit = 0; bit < bits_; ++bit) {
+        masks_[bit] = masks[bit];
+        rows[bit] = masks[bit] & low_mask;
+        inverse_[bit] = 1ULL << bit;
+    }
+    for (int column = 0; column < bits_; ++column) {
+        int pivot = column;
+        while (pivot < bits_ && ((rows[pivot] >> column) & 1) == 0) {
+            pivot++;
+        }
+        if (pivot == bits_) {
+            invertible_ = false;
+            return;
+        }
+        std::swap(rows[pivot], rows[column]);
+        std::swap(inverse_[pivot], inverse_[column]);
+        for (int row = 0; row < bits_; ++row) {
+            if (row != column && ((rows[row] >> column) & 1)) {
+                rows[row] ^= rows[column];
+                inverse_[row] ^= inverse_[column];
+            }
+        }
+    }
+}
+
+
+SkewedIndex::SkewedIndex(unsigned long long sets, int ways)
+    : bits_(countTrailingZeros(sets)), shift_((bits_ == 0) ? 63 : 64 - bits_), mask_(sets - 1), multipliers_((std::size_t)ways) {
+    for (int way = 0; way < ways; ++way) {
+        multipliers_[(std::size_t)way] = mixWay((unsigned long long)way) | 1;
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Bits.h"
+#include "Config.h"
+
+//Set index functions: how a block number (an address without its offset bits) picks its
+//set, and what is left of it as the tag. Each one is a small class that the cache engine
+//takes as a template parameter, so the choice is made at compile time and inlined into the
+//access path. join() undoes split(): the cache rebuilds the addresses of its blocks from
+//their set and tag.
+//
+//INDEX_FUNCTION picks one:
+//  MODULO       the block modulo the number of sets (its low bits for a power of two)
+//  XOR_FOLD     the low bits XORed with every higher group of as many bits
+//  HASH_MATRIX  every index bit the parity of the block ANDed with a mask of its own, as
+//               the slice and set hashes of Intel and AMD last-level caches are built
+//  SKEWED       a different hash for every way (skewed-associative), see SkewedIndex
+//The hashed ones need a power-of-two number of sets.
+
+enum class IndexFunction {
+    Modulo,
+    XorFold,
+    HashMatrix,
+    Skewed
+};
+
+//Accepts MODULO, XOR_FOLD, HASH_MATRIX and SKEWED in any case.
+//Prints an error and returns false for anything else.
+bool parseIndexFunction(const std::string& name, IndexFunction& function);
+
+const char* indexFunctionName(IndexFunction function);
+
+struct IndexConfig {
+    IndexFunction function = IndexFunction::Modulo;
+    std::vector<unsigned long long> hash_masks; //HASH_MATRIX: one per index bit, lowest first
+};
+
+//Reads prefix + INDEX_FUNCTION and, for HASH_MATRIX, prefix + INDEX_HASH_MASKS: masks over
+//the block number, in hex (0x...) or decimal, separated by commas or spaces.
+//Whether they fit the cache is checked by checkIndexConfig (see Cache.h).
+//Prints an error and returns false for a bad value.
+bool readIndexConfig(const Config& config, const std::string& prefix, IndexConfig& index);
+
+
+//The low bits of the block, for a power-of-two number of sets
+class PowerOfTwoIndex {
+public:
+    PowerOfTwoIndex() : bits_(0), mask_(0) {}
+
+    //sets must be a power of two
+    explicit PowerOfTwoIndex(unsigned long long sets) : bits_(countTrailingZeros(sets)), mask_(sets - 1) {}
+
+    void split(unsigned long long block, unsigned long long& index, unsigned long long& tag) const {
+        index = block & mask_;
+        tag = block >> bits_;
+    }
+
+    unsigned long long join(unsigned long long tag, unsigned long long index) const {
+        return (tag << bits_) | index;
+    }
+
+private:
+    int bits_;
+    unsigned long long mask_;
+};
+
+
+//The block modulo the number of sets, with the quotient as the tag. Any number of sets
+//works, which sliced LLCs need: their sets rarely add up to a power of two.
+//
+//The division is a multiply by the reciprocal floor((2^64 - 1) / sets). The quotient that
+//gives is exact or one too small, and a single compare corrects it.
+class ModuloIndex {
+public:
+    ModuloIndex() : sets_(1), reciprocal_(~0ULL) {}
+
+    explicit ModuloIndex(unsigned long long sets) : sets_(sets), reciprocal_(~0ULL / sets) {}
+
+    void split(unsigned long long block, unsigned long long& index, unsigned long long& tag) const {
+        unsigned long long quotient = multiplyHigh64(block, reciprocal_);
+        unsigned long long remainder = block - quotient * sets_;
+        if (remainder >= sets_) {
+            quotient++;
+            remainder -= sets_;
+        }
+        index = remainder;
+        tag = quotient;
+    }
+
+    unsigned long long join(unsigned long long tag, unsigned long long index) const {
+        return tag * sets_ + index;
+    }
+
+private:
+    unsigned long long sets_;
+    unsigned long long reciprocal_;
+};
+
+
+//The XOR of all index-sized groups of bits of the block, so a power-of-two stride that
+//keeps the low bits still spreads over the sets. The tag is the block without its low
+//bits, as for PowerOfTwoIndex, which is what lets join XOR them back out.
+class XorFoldIndex {
+public:
+    XorFoldIndex() : bits_(0), mask_(0) {}
+
+    //sets must be a power of two
+    explicit XorFoldIndex(unsigned long long sets) : bits_(countTrailingZeros(sets)), mask_(sets - 1) {}
+
+    void split(unsigned long long block, unsigned long long& index, unsigned long long& tag) const {
+        index = fold(block);
+        tag = block >> bits_;
+    }
+
+    unsigned long long join(unsigned long long tag, unsigned long long index) const {
+        return (tag << bits_) | (index ^ fold(tag));
+    }
+
+private:
+    //Doubling the shift every step leaves the XOR of all groups in the lowest one
+    unsigned long long fold(unsigned long long value) const {
+        for (int shift = bits_; shift > 0 && shift < 64; shift *= 2) {
+            value ^= value >> shift;
+        }
+        return value & mask_;
+    }
+
+    int bits_;
+    unsigned long long mask_;
+};
+
+
+//Index bit i is the parity of block & masks[i]. The tag is the block without its low bits,
+//so the masks must mix those low bits in an invertible way (over GF(2)) for two blocks of
+//the same tag to get different sets, and join uses that inverse. The masks may pick any of
+//the higher bits.
+class HashMatrixIndex {
+public:
+    //num_sets is at most 2^31 - 1, so 30 index bits
+    static const int MAX_BITS = 32;
+
+    HashMatrixIndex() : bits_(0), invertible_(true), masks_(), inverse_() {}
+
+    //One mask per index bit, lowest first
+    explicit HashMatrixIndex(const std::vector<unsigned long long>& masks);
+
+    //False if the low bits of the masks are not invertible, and the index must not be used
+    bool invertible() const { return invertible_; }
+
+    int bits() const { return bits_; }
+    unsigned long long mask(int bit) const { return masks_[bit]; }
+
+    void split(unsigned long long block, unsigned long long& index, unsigned long long& tag) const {
+        unsigned long long hashed = 0;
+        for (int bit = 0; bit < bits_; ++bit) {
+            hashed |= (unsigned long long)parity64(block & masks_[bit]) << bit;
+        }
+        index = hashed;
+        tag = block >> bits_;
+    }
+
+    unsigned long long join(unsigned long long tag, unsigned long long index) const {
+        //Take out what the tag bits added, then undo the matrix on the low bits
+        unsigned long long high = tag << bits_;
+        unsigned long long low_hash = index;
+        for (int bit = 0; bit < bits_; ++bit) {
+            low_hash ^= (unsigned long long)parity64(high & masks_[bit]) << bit;
+        }
+        unsigned long long low = 0;
+        for (int bit = 0; bit < bits_; ++bit) {
+            low |= (unsigned long long)parity64(low_hash & inverse_[bit]) << bit;
+        }
+        return high | low;
+    }
+
+private:
+    int bits_;
+    bool invertible_;
+    unsigned long long masks_[MAX_BITS];
+    unsigned long long inverse_[MAX_BITS]; //Row i gives low bit i from the low bits' hash
+};
+
+
+//Skewed-associative placement (Seznec): way w of a block is in set
+//  low bits ^ top bits of (block >> index bits) * K[w]
+//with a different odd K per way. Blocks that collide in one way are unlikely to collide in
+//the next, so power-of-two strides do not pile up in a handful of sets. There is then no
+//single set to split a block into: the cache stores the whole block number as the tag and
+//looks for it way by way, see Cache::accessSkewed.
+class SkewedIndex {
+public:
+    SkewedIndex() : bits_(0), shift_(63), mask_(0) {}
+
+    //sets must be a power of two
+    SkewedIndex(unsigned long long sets, int ways);
+
+    unsigned long long set(unsigned long long block, int way) const {
+        return (block ^ (((block >> bits_) * multipliers_[way]) >> shift_)) & mask_;
+    }
+
+private:
+    int bits_;
+    int shift_; //64 - bits_, kept in range for a single set
+    unsigned long long mask_;
+    std::vector<unsigned long long> multipliers_;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Lock-free single-producer / single-consumer ring of preallocated slots.
+//
+//The producer fills the slot returned by writeSlot() and hands it over with publish();
+//the consumer reads the slot returned by readSlot() and gives it back with release().
+//Slots are reused in place, so nothing is allocated once the ring is built, and the
+//only shared state is the two counters.
+//
+//A side that finds the ring full or empty calls waitForSlot() or waitForData() in a loop.
+//Those spin, then yield, then park on a condition variable, so a stalled input (a tracer
+//pipe with nothing to say) costs no CPU. publish() and release() only take the lock when
+//the other side is parked.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(std::size_t capacity) : slots_(capacity), head_(0), tail_(0), sleepers_(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t capacity() const { return slots_.size(); }
+
+    //Every slot, for preallocating buffers before the threads start
+    std::vector<T>& slots() { return slots_; }
+
+    //Producer: the next free slot, or nullptr if the consumer has not caught up
+    T* writeSlot() {
+        std::size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == slots_.size()) {
+            return nullptr;
+        }
+        return &slots_[tail % slots_.size()];
+    }
+
+    void publish() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wakeParked();
+    }
+
+    //Consumer: the oldest published slot, or nullptr if the ring is empty
+    T* readSlot() {
+        std::size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots_[head % slots_.size()];
+    }
+
+    void release() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wakeParked();
+    }
+
+    //Waits a little for writeSlot() or readSlot() to have something, counting the calls in
+    //spins (0 at the start of a wait). May return early, the caller checks again.
+    void waitForSlot(int& spins) { backoff(spins, true); }
+    void waitForData(int& spins) { backoff(spins, false); }
+
+    //Wakes both sides, for a stop flag the caller set
+    void wakeAll() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_.notify_all();
+    }
+
+private:
+    //Spins, then yields for a few milliseconds, before parking. Chunks are large, so the
+    //other side normally needs microseconds, but a stalled input can take seconds.
+    static const int RING_SPINS = 64;
+    static const int RING_YIELDS = 4096;
+
+    bool full() const { return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) == slots_.size(); }
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+
+    void backoff(int& spins, bool producer) {
+        if (++spins < RING_SPINS) {
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            return;
+        }
+        if (spins < RING_SPINS + RING_YIELDS) {
+            std::this_thread::yield();
+            return;
+        }
+        //Announce the sleeper before the last look at the counters, and pair that with the
+        //fence in wakeParked, so either this side sees the update or the other sees it parked.
+        //The timeout is only a safety net.
+        std::unique_lock<std::mutex> lock(mutex_);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producer ? full() : empty()) {
+            wake_.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void wakeParked() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers_.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_.notify_all();
+        }
+    }
+
+    std::vector<T> slots_;
+    std::atomic<std::size_t> head_; //Slots released by the consumer
+    char padding_[64]; //Keeps the two counters on separate host cache lines
+    std::atomic<std::size_t> tail_; //Slots published by the producer
+    char padding_tail_[64]; //And the tail off the line of the parking state
+    std::atomic<int> sleepers_; //Sides parked in backoff
+    std::mutex mutex_;
+    std::condition_variable wake_;
+};
+
@@ -0,0 +1,260 @@
+#include "StackDistance.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+
+#include "TraceBroadcast.h"
+
+long long StackDistanceCurve::hits(long long ways) const {
+    long long total = 0;
+    for (long long distance = 0; distance < ways && distance < (long long)distance_counts.size(); ++distance) {
+        total += distance_counts[distance];
+    }
+    return total;
+}
+
+
+const unsigned int StackDistanceAnalyzer::NO_SLOT;
+
+StackDistanceAnalyzer::StackDistanceAnalyzer(int num_sets, int block_size)
+    : offset_bits_(0), set_mask_((unsigned long long)num_sets - 1), num_sets_(num_sets), sets_(num_sets) {
+    while ((1 << offset_bits_) < block_size) {
+        offset_bits_++;
+    }
+    curve_.num_sets = num_sets;
+    curve_.block_size = block_size;
+}
+
+
+void StackDistanceAnalyzer::resetCurve() {
+    curve_.accesses = 0;
+    curve_.cold_misses = 0;
+    curve_.distance_counts.clear();
+}
+
+
+void StackDistanceAnalyzer::access(const TraceRecord* records, std::size_t count) {
+    //The table lookup is the one random memory access per record, so start it a few
+    //records ahead
+    const std::size_t PREFETCH_DISTANCE = 16;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i + PREFETCH_DISTANCE < count) {
+            table_.prefetch(records[i + PREFETCH_DISTANCE].address >> offset_bits_);
+        }
+        unsigned long long block = records[i].address >> offset_bits_;
+        accessBlock(block, sets_[block & set_mask_]);
+    }
+    curve_.accesses += (long long)count;
+}
+
+
+void StackDistanceAnalyzer::accessBlock(unsigned long long block, SetStack& set) {
+    //Re-using the set's most recent block (distance 0) changes nothing
+    if (set.next_slot > 0 && set.last_block == block) {
+        curve_.distance_counts[0]++;
+        return;
+    }
+
+    if (set.next_slot == set.slot_entry.size()) {
+        compact(set);
+    }
+
+    //Growing the table moves the entries, which their slots have to follow
+    bool inserted;
+    std::size_t entry = table_.insert(block, 0, inserted,
+        [this](unsigned long long moved_block, unsigned int moved_slot, std::size_t moved_to) {
+            sets_[(std::size_t)(moved_block % num_sets_)].slot_entry[moved_slot] = (unsigned int)moved_to;
+        });
+    unsigned int slot = table_.value(entry);
+    if (!inserted) {
+        //Distance = blocks of this set whose last access is after this block's
+        unsigned int before = 0;
+        for (unsigned int i = slot + 1; i > 0; i -= i & (0u - i)) {
+            before += set.tree[i];
+        }
+        unsigned int distance = set.live - before;
+        if (distance >= curve_.distance_counts.size()) {
+            curve_.distance_counts.resize(distance + 1, 0);
+        }
+        curve_.distance_counts[distance]++;
+
+        //The block's previous access is no longer its last one. Nodes past the last used
+        //slot do not exist yet, they are summed up when their slot is reached.
+        for (unsigned int i = slot + 1; i <= set.next_slot; i += i & (0u - i)) {
+            set.tree[i]--;
+        }
+        set.slot_entry[slot] = NO_SLOT;
+    }
+    else {
+        curve_.cold_misses++;
+        set.live++;
+        if (curve_.distance_counts.empty()) {
+            curve_.distance_counts.resize(1, 0);
+        }
+    }
+
+    //Record this access in the next free slot. Its Fenwick node covers the slots
+    //(node - lowbit(node), node], all of them already summed up in the nodes below it.
+    slot = set.next_slot++;
+    set.last_block = block;
+    set.slot_entry[slot] = (unsigned int)entry;
+    table_.value(entry) = slot;
+    unsigned int node = slot + 1;
+    unsigned int sum = 1;
+    for (unsigned int child = node - 1; child > node - (node & (0u - node)); child -= child & (0u - child)) {
+        sum += set.tree[child];
+    }
+    set.tree[node] = sum;
+}
+
+
+void StackDistanceAnalyzer::compact(SetStack& set) {
+    //Room for every live block plus as many accesses again, so compaction stays
+    //amortized O(1) per access
+    unsigned int capacity = 2 * (set.live + 1);
+    if (capacity < 16) {
+        capacity = 16;
+    }
+
+    //Keep only the slots that are still some block's last access, in order
+    std::vector<unsigned int> slot_entry(capacity, NO_SLOT);
+    unsigned int live = 0;
+    for (unsigned int old_slot = 0; old_slot < set.next_slot; ++old_slot) {
+        unsigned int entry = set.slot_entry[old_slot];
+        if (entry != NO_SLOT) {
+            table_.value(entry) = live;
+            slot_entry[live++] = entry;
+        }
+    }
+
+    //Fenwick nodes for the `live` slots in use, the rest are built as slots are appended
+    std::vector<unsigned int> tree(capacity + 1, 0);
+    for (unsigned int i = 1; i <= live; ++i) {
+        tree[i] += 1;
+        unsigned int parent = i + (i & (0u - i));
+        if (parent <= live) {
+            tree[parent] += tree[i];
+        }
+    }
+
+    set.slot_entry.swap(slot_entry);
+    set.tree.swap(tree);
+    set.next_slot = live;
+}
+
+
+std::vector<StackDistanceCurve> runStackDistance(TraceReader& trace, const std::vector<int>& set_counts,
+    int block_size, int threads) {
+    std::vector<StackDistanceCurve> curves(set_counts.size());
+    int workers = (threads < (int)set_counts.size()) ? threads : (int)set_counts.size();
+
+    if (workers <= 1) {
+        std::vector<StackDistanceAnalyzer> analyzers;
+        analyzers.reserve(set_counts.size());
+        for (int sets : set_counts) {
+            analyzers.emplace_back(sets, block_size);
+        }
+
+        std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+        std::size_t batch_count;
+        while ((batch_count = trace.read(batch.data(), batch.size())) > 0) {
+            for (StackDistanceAnalyzer& analyzer : analyzers) {
+                analyzer.access(batch.data(), batch_count);
+            }
+        }
+
+        for (std::size_t i = 0; i < analyzers.size(); ++i) {
+            curves[i] = analyzers[i].curve();
+        }
+        return curves;
+    }
+
+    //Worker w takes set counts w, w + workers, ...
+    broadcastTrace(trace, workers, [&](int worker, TraceChunkReader& reader) {
+        std::vector<std::size_t> mine;
+        std::vector<StackDistanceAnalyzer> analyzers;
+        for (std::size_t i = (std::size_t)worker; i < set_counts.size(); i += workers) {
+            mine.push_back(i);
+        }
+        analyzers.reserve(mine.size());
+        for (std::size_t i : mine) {
+            analyzers.emplace_back(set_counts[i], block_size);
+        }
+
+        const TraceRecord* records;
+        std::size_t count;
+        while (reader.next(records, count)) {
+            for (StackDistanceAnalyzer& analyzer : analyzers) {
+                analyzer.access(records, count);
+            }
+        }
+
+        for (std::size_t i = 0; i < mine.size(); ++i) {
+            curves[mine[i]] = analyzers[i].curve();
+        }
+    });
+    return curves;
+}
+
+
+namespace {
+
+//Size of num_sets * ways * block_size bytes in KB
+double curveSizeKb(const StackDistanceCurve& curve, long long ways) {
+    return (double)curve.num_sets * ways * curve.block_size / 1024.0;
+}
+
+} // namespace
+
+
+void printStackDistanceCurve(const StackDistanceCurve& curve) {
+    std::cout << "\n--- LRU Hit Rate Curve: " << curve.num_sets << " set(s), " << curve.block_size << "B blocks ---" << std::endl;
+    std::cout << std::left << std::setw(10) << "Ways" << std::setw(14) << "Size KB" << std::setw(14) << "Hits"
+        << std::setw(14) << "Misses" << "Hit Rate" << std::endl;
+
+    //Every power of two up to the first associativity that hits everything it can
+    long long hits = 0;
+    long long counted = 0;
+    for (long long ways = 1;; ways *= 2) {
+        for (; counted < ways && counted < (long long)curve.distance_counts.size(); ++counted) {
+            hits += curve.distance_counts[counted];
+        }
+        double hit_rate = (curve.accesses == 0) ? 0.0 : (double)hits / curve.accesses;
+        std::cout << std::left << std::setw(10) << ways << std::setw(14) << std::fixed << std::setprecision(2) << curveSizeKb(curve, ways)
+            << std::setw(14) << hits << std::setw(14) << (curve.accesses - hits)
+            << std::setprecision(4) << (hit_rate * 100.0) << "%" << std::endl;
+        if (ways >= curve.maxUsefulWays()) {
+            break;
+        }
+    }
+    std::cout << std::right << "Cold Misses: " << curve.cold_misses << std::endl;
+    std::cout << "---------------------" << std::endl;
+}
+
+
+bool writeStackDistanceCsv(const std::string& filename, const std::vector<StackDistanceCurve>& curves) {
+    std::ofstream csv(filename);
+    if (!csv.is_open()) {
+        std::cerr << "Error: Could not open " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    csv << "sets,block_size,ways,cache_size_bytes,hits,misses,hit_rate\n";
+    for (const StackDistanceCurve& curve : curves) {
+        long long hits = 0;
+        for (long long ways = 1; ways <= curve.maxUsefulWays(); ++ways) {
+            hits += curve.distance_counts[ways - 1];
+            double hit_rate = (curve.accesses == 0) ? 0.0 : (double)hits / curve.accesses;
+            csv << curve.num_sets << ',' << curve.block_size << ',' << ways << ','
+                << (long long)curve.num_sets * ways * curve.block_size << ',' << hits << ','
+                << (curve.accesses - hits) << ',' << std::setprecision(8) << hit_rate << '\n';
+        }
+    }
+
+    if (!csv) {
+        std::cerr << "Error: Failed writing " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "BlockTable.h"
+#include "Trace.h"
+
+//Single-pass LRU miss-rate curves (Mattson et al., 1970).
+//
+//With a fixed block size and number of sets, an LRU cache with W ways hits exactly the
+//accesses whose stack distance is below W: the number of distinct other blocks of the same
+//set touched since the previous access to the block. One pass that records the histogram
+//of stack distances therefore gives the hits of every associativity, i.e. of every cache
+//size num_sets * W * block_size. One set is a fully-associative cache.
+//
+//Each set keeps a Fenwick tree over its own access slots with a 1 at the last access of
+//every block; the distance is the number of 1s after the block's previous slot. Slots are
+//compacted once a set runs out of them, so memory grows with the number of distinct blocks,
+//not with the length of the trace.
+
+//Hits of every associativity for one (num_sets, block_size) pair
+struct StackDistanceCurve {
+    int num_sets = 0;
+    int block_size = 0;
+    long long accesses = 0;
+    long long cold_misses = 0; //First touches, a miss at any size
+    std::vector<long long> distance_counts; //Accesses per stack distance
+
+    //Hits of an LRU cache with this many ways
+    long long hits(long long ways) const;
+
+    //Smallest associativity that hits every non-cold access
+    long long maxUsefulWays() const { return (long long)distance_counts.size(); }
+};
+
+
+class StackDistanceAnalyzer {
+public:
+    //block_size must be a power of two, and so must num_sets for access()
+    StackDistanceAnalyzer(int num_sets, int block_size);
+
+    void access(const TraceRecord* records, std::size_t count);
+
+    //One access to block (an address without its offset bits), for callers that already
+    //know its set, block % num_sets
+    void accessInSet(unsigned long long block, std::size_t set) {
+        accessBlock(block, sets_[set]);
+        curve_.accesses++;
+    }
+
+    const StackDistanceCurve& curve() const { return curve_; }
+
+    //Zeroes the curve but keeps the stacks, so later accesses still see the earlier ones
+    void resetCurve();
+
+private:
+    //LRU stack of one set
+    struct SetStack {
+        std::vector<unsigned int> tree; //Fenwick tree over the slots, 1-based
+        std::vector<unsigned int> slot_entry; //Table entry of the block accessed in each slot, NO_SLOT once stale
+        unsigned long long last_block = 0; //Block of the most recent access, valid once next_slot > 0
+        unsigned int next_slot = 0;
+        unsigned int live = 0; //Distinct blocks seen in this set
+    };
+
+    void accessBlock(unsigned long long block, SetStack& set);
+
+    //Renumbers the live slots of a set from 0 and makes room for at least as many again
+    void compact(SetStack& set);
+
+    static const unsigned int NO_SLOT = 0xFFFFFFFFu;
+
+    int offset_bits_;
+    unsigned long long set_mask_; //For power-of-two set counts
+    unsigned long long num_sets_;
+    std::vector<SetStack> sets_;
+
+    BlockTable table_; //Block number to the slot of its last access
+
+    StackDistanceCurve curve_;
+};
+
+
+//Decodes the trace once and feeds every analyzer. With more than one thread the analyzers
+//are spread over worker threads that read the same decoded chunks.
+//Returns the curves in the order of set_counts.
+std::vector<StackDistanceCurve> runStackDistance(TraceReader& trace, const std::vector<int>& set_counts,
+    int block_size, int threads);
+
+//Prints a table of the curve at every power-of-two associativity
+void printStackDistanceCurve(const StackDistanceCurve& curve);
+
+//Writes every point of the curves (one line per associativity) as CSV.
+//Returns false (after printing an error) if the file cannot be written.
+bool writeStackDistanceCsv(const std::string& filename, const std::vector<StackDistanceCurve>& curves);
@@ -0,0 +1,154 @@
+#include "Sweep.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "TraceBroadcast.h"
+
+bool parseSweepFile(const std::string& filename, std::vector<SweepPoint>& points) {
+    std::ifstream sweepFile(filename);
+    if (!sweepFile.is_open()) {
+        std::cerr << "Error: Could not open sweep file " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(sweepFile, line)) {
+        line_number++;
+        std::stringstream ss(line);
+        std::string first;
+        if (!(ss >> first) || first[0] == '#') {
+            continue; //Skip blank lines and comments
+        }
+
+        SweepPoint point;
+        ss.clear();
+        ss.str(line);
+        if (!(ss >> point.cache_size_kb >> point.block_size >> point.associativity >> point.policy)) {
+            std::cerr << "Error: Line " << line_number << " of " << filename
+                << " is not 'CACHE_SIZE_KB BLOCK_SIZE_BYTES ASSOCIATIVITY REPLACEMENT_POLICY'" << std::endl;
+            return false;
+        }
+        points.push_back(point);
+    }
+
+    if (points.empty()) {
+        std::cerr << "Error: Sweep file " << filename << " has no configurations" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool prepareSweep(std::vector<SweepPoint>& points) {
+    for (SweepPoint& point : points) {
+        if (!parseReplacementPolicy(point.policy, point.replacement)) {
+            return false;
+        }
+        if (!computeGeometry(point.cache_size_kb * 1024, point.block_size, point.associativity, point.geometry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+namespace {
+
+//Spreads the points over workers so that the slowest worker has as little to do as possible.
+//The cost of an access grows with the number of ways the engine has to scan.
+std::vector<std::vector<std::size_t>> assignWorkers(const std::vector<SweepPoint>& points, int workers) {
+    std::vector<std::size_t> order(points.size());
+    for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return points[a].associativity > points[b].associativity;
+    });
+
+    std::vector<std::vector<std::size_t>> assignment(workers);
+    std::vector<long long> load(workers, 0);
+    for (std::size_t point : order) {
+        int lightest = (int)(std::min_element(load.begin(), load.end()) - load.begin());
+        assignment[lightest].push_back(point);
+        load[lightest] += 1 + points[point].associativity;
+    }
+    return assignment;
+}
+
+void sweepWorker(TraceChunkReader& reader, const std::vector<SweepPoint>& points,
+    const std::vector<std::size_t>& mine, std::vector<CacheStats>& results) {
+    //The caches are built here so their storage is allocated (and first touched) by the
+    //thread that uses it, and no two workers ever write to the same host cache line
+    std::vector<Cache> caches;
+    caches.reserve(mine.size());
+    for (std::size_t point : mine) {
+        caches.emplace_back(points[point].geometry, points[point].replacement);
+    }
+
+    const TraceRecord* records;
+    std::size_t count;
+    while (reader.next(records, count)) {
+        for (Cache& cache : caches) {
+            cache.access(records, count);
+        }
+    }
+
+    for (std::size_t i = 0; i < mine.size(); ++i) {
+        results[mine[i]] = caches[i].stats();
+    }
+}
+
+} // namespace
+
+
+std::vector<CacheStats> runSweep(TraceReader& trace, const std::vector<SweepPoint>& points, int threads) {
+    std::vector<CacheStats> results(points.size());
+    int workers = (threads < (int)points.size()) ? threads : (int)points.size();
+
+    if (workers <= 1) {
+        std::vector<Cache> caches;
+        caches.reserve(points.size());
+        for (const SweepPoint& point : points) {
+            caches.emplace_back(point.geometry, point.replacement);
+        }
+
+        //Every batch is decoded once and then replayed into each cache while it is still hot
+        std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+        std::size_t batch_count;
+        while ((batch_count = trace.read(batch.data(), batch.size())) > 0) {
+            for (Cache& cache : caches) {
+                cache.access(batch.data(), batch_count);
+            }
+        }
+
+        for (std::size_t i = 0; i < caches.size(); ++i) {
+            results[i] = caches[i].stats();
+        }
+        return results;
+    }
+
+    std::vector<std::vector<std::size_t>> assignment = assignWorkers(points, workers);
+    broadcastTrace(trace, workers, [&](int worker, TraceChunkReader& reader) {
+        sweepWorker(reader, points, assignment[worker], results);
+    });
+    return results;
+}
+
+
+void printSweepResults(const std::vector<SweepPoint>& points, const std::vector<CacheStats>& results) {
+    std::cout << "\n--- Sweep Results ---" << std::endl;
+    std::cout << std::left << std::setw(10) << "Size KB" << std::setw(8) << "Block" << std::setw(8) << "Ways"
+        << std::setw(8) << "Policy" << std::setw(14) << "Hits" << std::setw(14) << "Misses" << "Hit Rate" << std::endl;
+
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        const CacheStats& stats = results[i];
+        std::cout << std::left << std::setw(10) << points[i].cache_size_kb << std::setw(8) << points[i].block_size
+            << std::setw(8) << points[i].associativity << std::setw(8) << replacementPolicyName(points[i].replacement)
+            << std::setw(14) << stats.hits << std::setw(14) << stats.misses
+            << std::fixed << std::setprecision(4) << (stats.hitRate() * 100.0) << "%" << std::endl;
+    }
+    std::cout << std::right << "---------------------" << std::endl;
+}
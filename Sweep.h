@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Cache.h"
+#include "Trace.h"
+
+//One point of a design-space sweep
+struct SweepPoint {
+    long long cache_size_kb = 0;
+    int block_size = 0;
+    int associativity = 0;
+    std::string policy;
+    CacheGeometry geometry; //Filled in by prepareSweep
+    ReplacementPolicy replacement = ReplacementPolicy::Lru; //Parsed from policy by prepareSweep
+};
+
+//Reads a sweep file: one "CACHE_SIZE_KB BLOCK_SIZE_BYTES ASSOCIATIVITY REPLACEMENT_POLICY"
+//tuple per line, blank lines and lines starting with '#' are ignored.
+//Prints an error and returns false on a malformed line.
+bool parseSweepFile(const std::string& filename, std::vector<SweepPoint>& points);
+
+//Validates every point and works out its geometry.
+//Prints an error and returns false if a point is invalid.
+bool prepareSweep(std::vector<SweepPoint>& points);
+
+//Decodes the trace once and drives one cache per point from the same batches.
+//With more than one thread the caches are spread over worker threads; each worker builds
+//and owns its caches, and all of them read the same decoded chunks of the trace.
+//Returns the final counters in the order of points.
+std::vector<CacheStats> runSweep(TraceReader& trace, const std::vector<SweepPoint>& points, int threads);
+
+void printSweepResults(const std::vector<SweepPoint>& points, const std::vector<CacheStats>& results);
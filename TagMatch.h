@@ -0,0 +1,42 @@
+#pragma once
+
+//Tag comparison, the set scan done on every cache access.
+//
+//It has an AVX-512, an AVX2 and a scalar version. The vector versions are picked at
+//compile time (build with -mavx2 / -mavx512f, -march=native or /arch:AVX2 /
+//arch:AVX512 to enable them) and always return exactly what the scalar loop returns.
+
+#include "Bits.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+//Returns a mask with bit i set when tags[i] == tag, for i in [0, count) and count <= 64
+inline unsigned long long matchTags(const unsigned long long* tags, int count, unsigned long long tag) {
+    unsigned long long matches = 0;
+    int i = 0;
+
+#if defined(__AVX512F__)
+    __m512i needle = _mm512_set1_epi64((long long)tag);
+    for (; i < count; i += 8) {
+        int remaining = count - i;
+        __mmask8 lanes = (remaining >= 8) ? (__mmask8)0xFF : (__mmask8)((1u << remaining) - 1);
+        __m512i ways = _mm512_maskz_loadu_epi64(lanes, tags + i);
+        matches |= (unsigned long long)_mm512_mask_cmpeq_epi64_mask(lanes, ways, needle) << i;
+    }
+#elif defined(__AVX2__)
+    __m256i needle = _mm256_set1_epi64x((long long)tag);
+    for (; i + 4 <= count; i += 4) {
+        __m256i ways = _mm256_loadu_si256((const __m256i*)(tags + i));
+        __m256i equal = _mm256_cmpeq_epi64(ways, needle);
+        matches |= (unsigned long long)_mm256_movemask_pd(_mm256_castsi256_pd(equal)) << i;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        matches |= (unsigned long long)(tags[i] == tag) << i;
+    }
+    return matches;
+}
+
@@ -0,0 +1,742 @@
+#include "Trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Bits.h"
+#include "Compression.h"
+#include "TracePipeline.h"
+
+namespace {
+
+//Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size)) {
+            CloseHandle(file);
+            return false;
+        }
+        size_ = (std::size_t)file_size.QuadPart;
+        if (size_ == 0) {
+            //Windows refuses to map an empty file
+            CloseHandle(file);
+            return true;
+        }
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) {
+            return false;
+        }
+        data_ = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); //The view keeps the mapping alive
+        return data_ != nullptr;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size_ = (std::size_t)st.st_size;
+        if (size_ == 0) {
+            ::close(fd);
+            return true;
+        }
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); //The mapping stays valid after the descriptor is closed
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        //We only ever walk the trace front to back
+        madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = (const unsigned char*)mapped;
+        return true;
+#endif
+    }
+
+    void close() {
+        if (data_ != nullptr) {
+#ifdef _WIN32
+            UnmapViewOfFile(data_);
+#else
+            munmap((void*)data_, size_);
+#endif
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const unsigned char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_;
+    std::size_t size_;
+};
+
+
+//Reads a file, or stdin, with plain sequential reads
+class FileByteSource : public ByteSource {
+public:
+    FileByteSource() : file_(nullptr), owned_(false) {}
+    ~FileByteSource() {
+        if (owned_ && file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    bool open(const std::string& filename) {
+        file_ = std::fopen(filename.c_str(), "rb");
+        owned_ = true;
+        return file_ != nullptr;
+    }
+
+    void openStdin() {
+#ifdef _WIN32
+        //Traces are bytes, keep the CRT from translating line endings
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        file_ = stdin;
+        owned_ = false;
+    }
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        std::size_t got = std::fread(buffer, 1, size, file_);
+        if (got == 0 && std::ferror(file_)) {
+            throw std::runtime_error("Could not read the trace input");
+        }
+        return got;
+    }
+
+private:
+    std::FILE* file_;
+    bool owned_;
+};
+
+
+//Replays bytes that were read for format detection, then continues with the source
+class PrefixedByteSource : public ByteSource {
+public:
+    PrefixedByteSource(const unsigned char* prefix, std::size_t size, std::unique_ptr<ByteSource> source)
+        : prefix_(prefix, prefix + size), position_(0), source_(std::move(source)) {}
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        if (position_ < prefix_.size()) {
+            std::size_t take = prefix_.size() - position_;
+            if (take > size) take = size;
+            std::memcpy(buffer, prefix_.data() + position_, take);
+            position_ += take;
+            return take;
+        }
+        return source_->read(buffer, size);
+    }
+
+private:
+    std::vector<unsigned char> prefix_;
+    std::size_t position_;
+    std::unique_ptr<ByteSource> source_;
+};
+
+
+//Record size of the binary format the magic names, 0 if it is not a binary trace
+std::size_t binaryRecordSize(const unsigned char* magic) {
+    if (std::memcmp(magic, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC)) == 0) {
+        return BINARY_TRACE_RECORD_SIZE;
+    }
+    if (std::memcmp(magic, BINARY_TRACE_MAGIC_V1, sizeof(BINARY_TRACE_MAGIC_V1)) == 0) {
+        return BINARY_TRACE_RECORD_SIZE_V1;
+    }
+    return 0;
+}
+
+
+//Reads the binary format straight out of a memory mapping
+class BinaryTraceReader : public TraceReader {
+public:
+    BinaryTraceReader() : next_(nullptr), remaining_(0), record_size_(0), total_(0) {}
+
+    bool open(const std::string& filename) {
+        if (!file_.open(filename)) {
+            std::cerr << "Error: Could not map trace file " << filename << std::endl;
+            return false;
+        }
+        if (file_.size() < BINARY_TRACE_HEADER_SIZE || (record_size_ = binaryRecordSize(file_.data())) == 0) {
+            std::cerr << "Error: " << filename << " is not a binary trace" << std::endl;
+            return false;
+        }
+        unsigned long long record_count = loadLittleEndian64(file_.data() + sizeof(BINARY_TRACE_MAGIC));
+        if (record_count > (file_.size() - BINARY_TRACE_HEADER_SIZE) / record_size_) {
+            std::cerr << "Error: Binary trace " << filename << " is truncated" << std::endl;
+            return false;
+        }
+        next_ = file_.data() + BINARY_TRACE_HEADER_SIZE;
+        remaining_ = (std::size_t)record_count;
+        total_ = (long long)record_count;
+        return true;
+    }
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override {
+        std::size_t count = (remaining_ < max_records) ? remaining_ : max_records;
+        const bool has_core = (record_size_ == BINARY_TRACE_RECORD_SIZE);
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i].address = loadLittleEndian64(next_);
+            out[i].access_type = (char)next_[8];
+            out[i].core = has_core ? next_[9] : 0;
+            next_ += record_size_;
+        }
+        remaining_ -= count;
+        return count;
+    }
+
+    long long totalRecords() const override { return total_; }
+
+    //Nothing to decode, just move past the records
+    long long skip(long long count) override {
+        std::size_t skipped = ((unsigned long long)count < remaining_) ? (std::size_t)count : remaining_;
+        next_ += skipped * record_size_;
+        remaining_ -= skipped;
+        return (long long)skipped;
+    }
+
+private:
+    MappedFile file_;
+    const unsigned char* next_;
+    std::size_t remaining_;
+    std::size_t record_size_;
+    long long total_;
+};
+
+
+//Reads the binary format from a stream that cannot be memory-mapped (stdin, a pipe)
+class StreamBinaryTraceReader : public TraceReader {
+public:
+    //The magic has already been consumed by the format detection, which found record_size
+    StreamBinaryTraceReader(std::unique_ptr<ByteSource> source, std::size_t record_size)
+        : source_(std::move(source)), buffer_(STREAM_CHUNK_RECORDS * record_size),
+          begin_(0), end_(0), remaining_(0), record_size_(record_size), total_(0) {}
+
+    bool readHeader() {
+        unsigned char count_bytes[8];
+        if (fill(count_bytes, sizeof(count_bytes)) != sizeof(count_bytes)) {
+            std::cerr << "Error: Binary trace stream ends inside its header" << std::endl;
+            return false;
+        }
+        remaining_ = loadLittleEndian64(count_bytes);
+        total_ = (long long)remaining_;
+        return true;
+    }
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override {
+        std::size_t count = 0;
+        while (count < max_records && remaining_ > 0) {
+            if (end_ - begin_ < record_size_) {
+                refill();
+                if (end_ - begin_ < record_size_) {
+                    throw std::runtime_error("Binary trace stream ends before its last record");
+                }
+            }
+            const unsigned char* next = buffer_.data() + begin_;
+            std::size_t available = (end_ - begin_) / record_size_;
+            std::size_t take = max_records - count;
+            if (take > available) take = available;
+            if (take > remaining_) take = (std::size_t)remaining_;
+
+            const bool has_core = (record_size_ == BINARY_TRACE_RECORD_SIZE);
+            for (std::size_t i = 0; i < take; ++i) {
+                out[count + i].address = loadLittleEndian64(next);
+                out[count + i].access_type = (char)next[8];
+                out[count + i].core = has_core ? next[9] : 0;
+                next += record_size_;
+            }
+            begin_ += take * record_size_;
+            remaining_ -= take;
+            count += take;
+        }
+        return count;
+    }
+
+    long long totalRecords() const override { return total_; }
+
+private:
+    static const std::size_t STREAM_CHUNK_RECORDS = 1 << 16;
+
+    //Reads exactly size bytes unless the stream ends first
+    std::size_t fill(unsigned char* out, std::size_t size) {
+        std::size_t got = 0;
+        while (got < size) {
+            std::size_t n = source_->read(out + got, size - got);
+            if (n == 0) break;
+            got += n;
+        }
+        return got;
+    }
+
+    //Keeps the partial record at the end of the buffer and reads the next chunk behind it.
+    //A source may return fewer bytes than asked (a decompressor stops at its frame and block
+    //boundaries), so keep reading until there is a whole record or the stream ends.
+    void refill() {
+        std::size_t leftover = end_ - begin_;
+        std::memmove(buffer_.data(), buffer_.data() + begin_, leftover);
+        begin_ = 0;
+        end_ = leftover;
+        do {
+            std::size_t n = source_->read(buffer_.data() + end_, buffer_.size() - end_);
+            if (n == 0) break;
+            end_ += n;
+        } while (end_ < record_size_);
+    }
+
+    std::unique_ptr<ByteSource> source_;
+    std::vector<unsigned char> buffer_;
+    std::size_t begin_;
+    std::size_t end_;
+    unsigned long long remaining_;
+    std::size_t record_size_;
+    long long total_;
+};
+
+
+//Character classes used by the text parser. Whitespace matches std::isspace in
+//the "C" locale, which is what the old stringstream based parser relied on.
+struct TextParserTables {
+    bool is_space[256];
+    unsigned char digit_value[256]; //Value of a hex digit, 0xFF for anything else
+
+    TextParserTables() {
+        for (int c = 0; c < 256; ++c) {
+            is_space[c] = (c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r');
+            digit_value[c] = 0xFF;
+        }
+        for (int c = '0'; c <= '9'; ++c) digit_value[c] = (unsigned char)(c - '0');
+        for (int c = 'a'; c <= 'f'; ++c) digit_value[c] = (unsigned char)(c - 'a' + 10);
+        for (int c = 'A'; c <= 'F'; ++c) digit_value[c] = (unsigned char)(c - 'A' + 10);
+    }
+};
+
+const TextParserTables text_tables;
+
+
+//Parses an address token exactly like std::stoull(token, 0, 0): an optional sign,
+//then a "0x" prefix for hex, a leading "0" for octal, or plain decimal. Parsing stops at
+//the first character that is not a digit. Returns false if there are no digits at all or
+//the value does not fit, the two cases where std::stoull throws.
+bool parseAddress(const unsigned char* p, const unsigned char* end, unsigned long long& value,
+    bool& out_of_range) {
+    out_of_range = false;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    unsigned long long base = 10;
+    if (p < end && *p == '0') {
+        //"0x" only counts as a prefix if a hex digit follows, otherwise it is the number 0
+        if (end - p > 2 && (p[1] | 0x20) == 'x' && text_tables.digit_value[p[2]] < 16) {
+            base = 16;
+            p += 2;
+        }
+        else {
+            base = 8;
+        }
+    }
+
+    const unsigned char* digits = p;
+    unsigned long long result = 0;
+
+    if (base == 16) {
+        //The format generateTrace() writes, so it gets its own tight loop
+        unsigned long long digit;
+        while (p < end && (digit = text_tables.digit_value[*p]) < 16) {
+            out_of_range |= (result >> 60) != 0;
+            result = (result << 4) | digit;
+            ++p;
+        }
+    }
+    else {
+        unsigned long long digit;
+        while (p < end && (digit = text_tables.digit_value[*p]) < base) {
+            out_of_range |= result > (ULLONG_MAX - digit) / base;
+            result = result * base + digit;
+            ++p;
+        }
+    }
+
+    if (p == digits || out_of_range) {
+        return false;
+    }
+    value = negative ? (0ULL - result) : result;
+    return true;
+}
+
+
+//Reads the legacy "R 0x1a000" text format in large chunks and parses it in place.
+//Accepts the same input as the old getline/stringstream/stoull loop: a line is the
+//access type character followed by an address token, and lines with fewer than two
+//tokens are skipped. With core_ids, a decimal third token is the core ID ("R 0x1a000 3").
+//Anything else after the address is ignored.
+class TextTraceReader : public TraceReader {
+public:
+    //prefix holds bytes that were already read from source, e.g. by format detection
+    TextTraceReader(std::unique_ptr<ByteSource> source, const unsigned char* prefix, std::size_t prefix_size, bool core_ids)
+        : source_(std::move(source)), buffer_(TEXT_TRACE_CHUNK_SIZE), begin_(0), end_(prefix_size),
+          eof_(false), core_ids_(core_ids), line_number_(0) {
+        if (prefix_size > 0) {
+            std::memcpy(buffer_.data(), prefix, prefix_size);
+        }
+    }
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override {
+        std::size_t count = 0;
+
+        while (count < max_records) {
+            const unsigned char* line = buffer_.data() + begin_;
+            const unsigned char* limit = buffer_.data() + end_;
+            const unsigned char* newline = (const unsigned char*)std::memchr(line, '\n', end_ - begin_);
+
+            if (newline == nullptr) {
+                if (eof_) {
+                    if (begin_ == end_) {
+                        break; //Trace exhausted
+                    }
+                    //Last line without a trailing newline
+                    newline = limit;
+                }
+                else {
+                    refill();
+                    continue;
+                }
+            }
+
+            begin_ = (newline - buffer_.data()) + (newline < limit ? 1 : 0);
+            line_number_++;
+            if (parseLine(line, newline, out[count])) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+private:
+    static const std::size_t TEXT_TRACE_CHUNK_SIZE = 1 << 20;
+
+    //Moves the unparsed tail of the buffer to the front and reads the next chunk behind it
+    void refill() {
+        std::size_t leftover = end_ - begin_;
+        if (leftover > 0 && begin_ > 0) {
+            std::memmove(buffer_.data(), buffer_.data() + begin_, leftover);
+        }
+        begin_ = 0;
+        end_ = leftover;
+
+        //A single line longer than the whole buffer, grow it
+        if (end_ == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+
+        std::size_t got = source_->read(buffer_.data() + end_, buffer_.size() - end_);
+        end_ += got;
+        if (got == 0) {
+            eof_ = true;
+        }
+    }
+
+    bool parseLine(const unsigned char* p, const unsigned char* end, TraceRecord& record) {
+        //Access type: the first non-whitespace character
+        while (p < end && text_tables.is_space[*p]) ++p;
+        if (p == end) {
+            return false; //Skip empty lines
+        }
+        char access_type = (char)*p++;
+
+        //Address: the next whitespace separated token
+        while (p < end && text_tables.is_space[*p]) ++p;
+        if (p == end) {
+            return false; //Skip bad lines
+        }
+        const unsigned char* token = p;
+        while (p < end && !text_tables.is_space[*p]) ++p;
+
+        bool out_of_range;
+        if (!parseAddress(token, p, record.address, out_of_range)) {
+            std::string text((const char*)token, p - token);
+            std::string message = "Invalid address '" + text + "' on line " + std::to_string(line_number_) + " of the trace";
+            if (out_of_range) {
+                throw std::out_of_range(message);
+            }
+            throw std::invalid_argument(message);
+        }
+        record.access_type = access_type;
+        record.core = 0;
+        if (!core_ids_) {
+            return true;
+        }
+
+        //Optional core ID
+        while (p < end && text_tables.is_space[*p]) ++p;
+        unsigned int core = 0;
+        const unsigned char* digits = p;
+        for (; p < end && *p >= '0' && *p <= '9' && core <= UCHAR_MAX; ++p) {
+            core = core * 10 + (*p - '0');
+        }
+        if (core > UCHAR_MAX) {
+            throw std::out_of_range("Core ID above " + std::to_string(UCHAR_MAX) + " on line " + std::to_string(line_number_) + " of the trace");
+        }
+        record.core = (p > digits) ? (unsigned char)core : 0;
+        return true;
+    }
+
+    std::unique_ptr<ByteSource> source_;
+    std::vector<unsigned char> buffer_;
+    std::size_t begin_; //First unparsed byte in buffer_
+    std::size_t end_; //One past the last valid byte in buffer_
+    bool eof_;
+    bool core_ids_;
+    unsigned long long line_number_;
+};
+
+
+bool isBinaryTrace(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    unsigned char magic[sizeof(BINARY_TRACE_MAGIC)];
+    if (!file.read((char*)magic, sizeof(magic))) {
+        return false;
+    }
+    return binaryRecordSize(magic) != 0;
+}
+
+//Only regular files can be peeked at, reopened and memory-mapped
+bool isRegularFile(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+}
+
+} // namespace
+
+
+long long TraceReader::skip(long long count) {
+    std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+    long long skipped = 0;
+    while (skipped < count) {
+        std::size_t wanted = (count - skipped < (long long)batch.size()) ? (std::size_t)(count - skipped) : batch.size();
+        std::size_t got = read(batch.data(), wanted);
+        if (got == 0) {
+            break;
+        }
+        skipped += (long long)got;
+    }
+    return skipped;
+}
+
+
+std::unique_ptr<TraceReader> openTraceStream(std::unique_ptr<ByteSource> source, bool core_ids) {
+    //Read just far enough to tell the formats apart
+    unsigned char magic[sizeof(BINARY_TRACE_MAGIC)];
+    std::size_t got = 0;
+    while (got < sizeof(magic)) {
+        std::size_t n = source->read(magic + got, sizeof(magic) - got);
+        if (n == 0) break;
+        got += n;
+    }
+
+    Compression compression = detectCompression(magic, got);
+    if (compression != Compression::None) {
+        std::unique_ptr<ByteSource> compressed(new PrefixedByteSource(magic, got, std::move(source)));
+        std::unique_ptr<ByteSource> plain = openDecompressor(std::move(compressed), compression);
+        if (!plain) {
+            return nullptr;
+        }
+        //Decompress on a thread of its own so it overlaps with parsing and simulation
+        if (std::thread::hardware_concurrency() > 1) {
+            plain = pipelineBytes(std::move(plain));
+        }
+        //The decompressed stream can hold either format
+        return openTraceStream(std::move(plain), core_ids);
+    }
+
+    std::size_t record_size = (got == sizeof(magic)) ? binaryRecordSize(magic) : 0;
+    if (record_size != 0) {
+        StreamBinaryTraceReader* reader = new StreamBinaryTraceReader(std::move(source), record_size);
+        std::unique_ptr<TraceReader> owned(reader);
+        if (!reader->readHeader()) {
+            return nullptr;
+        }
+        return owned;
+    }
+    return std::unique_ptr<TraceReader>(new TextTraceReader(std::move(source), magic, got, core_ids));
+}
+
+
+std::unique_ptr<TraceReader> openTrace(const std::string& filename, bool core_ids) {
+    //Uncompressed binary files are the fast path: memory-mapped and decoded in place
+    if (filename != "-" && isRegularFile(filename) && isBinaryTrace(filename)) {
+        BinaryTraceReader* reader = new BinaryTraceReader();
+        std::unique_ptr<TraceReader> owned(reader);
+        if (!reader->open(filename)) {
+            return nullptr;
+        }
+        return owned;
+    }
+
+    //Everything else (text, compressed, stdin, pipes) is streamed
+    FileByteSource* source = new FileByteSource();
+    std::unique_ptr<ByteSource> owned(source);
+    if (filename == "-") {
+        source->openStdin();
+    }
+    else if (!source->open(filename)) {
+        std::cerr << "Error: Could not open trace file " << filename << std::endl;
+        return nullptr;
+    }
+    return openTraceStream(std::move(owned), core_ids);
+}
+
+
+bool writeBinaryTrace(TraceReader& reader, const std::string& filename, unsigned long long& record_count) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not create binary trace " << filename << std::endl;
+        return false;
+    }
+
+    //The record count is patched in once we know it
+    unsigned char header[BINARY_TRACE_HEADER_SIZE];
+    std::memcpy(header, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC));
+    storeLittleEndian64(header + sizeof(BINARY_TRACE_MAGIC), 0);
+    out.write((const char*)header, sizeof(header));
+
+    std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+    std::vector<unsigned char> encoded(TRACE_BATCH_SIZE * BINARY_TRACE_RECORD_SIZE);
+    record_count = 0;
+    std::size_t count;
+
+    while ((count = reader.read(batch.data(), batch.size())) > 0) {
+        unsigned char* next = encoded.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            storeLittleEndian64(next, batch[i].address);
+            next[8] = (unsigned char)batch[i].access_type;
+            next[9] = batch[i].core;
+            next += BINARY_TRACE_RECORD_SIZE;
+        }
+        out.write((const char*)encoded.data(), (std::streamsize)(count * BINARY_TRACE_RECORD_SIZE));
+        record_count += count;
+    }
+
+    storeLittleEndian64(header + sizeof(BINARY_TRACE_MAGIC), record_count);
+    out.seekp(0);
+    out.write((const char*)header, sizeof(header));
+
+    if (!out) {
+        std::cerr << "Error: Failed writing binary trace " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool writeTextTrace(TraceReader& reader, const std::string& filename, unsigned long long& record_count) {
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not create text trace " << filename << std::endl;
+        return false;
+    }
+
+    //Format whole batches by hand, "R 0x1a000" plus " 3" for a core other than 0.
+    //A line is at most 1 + 3 + 16 hex digits + 4 + 1 characters.
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+    std::vector<char> text(TRACE_BATCH_SIZE * 32);
+    record_count = 0;
+    std::size_t count;
+
+    while ((count = reader.read(batch.data(), batch.size())) > 0) {
+        char* next = text.data();
+        for (std::size_t i = 0; i < count; ++i) {
+            *next++ = batch[i].access_type;
+            *next++ = ' ';
+            *next++ = '0';
+            *next++ = 'x';
+            unsigned long long address = batch[i].address;
+            int digits = 1;
+            while (digits < 16 && (address >> (4 * digits)) != 0) {
+                digits++;
+            }
+            for (int d = digits - 1; d >= 0; --d) {
+                *next++ = HEX_DIGITS[(address >> (4 * d)) & 0xF];
+            }
+            if (batch[i].core != 0) {
+                *next++ = ' ';
+                unsigned int core = batch[i].core;
+                if (core >= 100) {
+                    *next++ = (char)('0' + core / 100);
+                }
+                if (core >= 10) {
+                    *next++ = (char)('0' + core / 10 % 10);
+                }
+                *next++ = (char)('0' + core % 10);
+            }
+            *next++ = '\n';
+        }
+        out.write(text.data(), (std::streamsize)(next - text.data()));
+        record_count += count;
+    }
+
+    if (!out) {
+        std::cerr << "Error: Failed writing text trace " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+bool convertTextTrace(const std::string& text_filename, const std::string& binary_filename) {
+    std::unique_ptr<TraceReader> reader = openTrace(text_filename);
+    if (!reader) {
+        return false;
+    }
+
+    unsigned long long record_count;
+    if (!writeBinaryTrace(*reader, binary_filename, record_count)) {
+        return false;
+    }
+    std::cout << "--- Converted " << record_count << " accesses from '" << text_filename
+        << "' to '" << binary_filename << "' ---" << std::endl;
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+//One decoded memory access from a trace
+struct TraceRecord {
+    unsigned long long address;
+    char access_type; //'R' or 'W'
+    unsigned char core; //Core that issued the access, 0 if the trace names none
+};
+
+//Binary trace layout (all integers little-endian):
+//  8 bytes  magic "CSTRACE2" ("CSTRACE1" for traces without core IDs)
+//  8 bytes  number of records
+//  then one record per access: 8 bytes of address, 1 byte of access type and, in
+//  CSTRACE2 only, 1 byte of core ID (10 or 9 bytes per record)
+const char BINARY_TRACE_MAGIC[8] = { 'C', 'S', 'T', 'R', 'A', 'C', 'E', '2' };
+const char BINARY_TRACE_MAGIC_V1[8] = { 'C', 'S', 'T', 'R', 'A', 'C', 'E', '1' };
+const std::size_t BINARY_TRACE_HEADER_SIZE = 16;
+const std::size_t BINARY_TRACE_RECORD_SIZE = 10;
+const std::size_t BINARY_TRACE_RECORD_SIZE_V1 = 9;
+
+//How many records the simulator decodes at a time
+const std::size_t TRACE_BATCH_SIZE = 4096;
+
+//Common interface for every trace format
+class TraceReader {
+public:
+    virtual ~TraceReader() {}
+
+    //Fills up to max_records entries of out and returns how many were read.
+    //Returns 0 once the trace is exhausted.
+    virtual std::size_t read(TraceRecord* out, std::size_t max_records) = 0;
+
+    //Records in the whole trace, or -1 if that is not known up front (text traces)
+    virtual long long totalRecords() const { return -1; }
+
+    //Passes over the next count records without returning them, to resume a run part way
+    //through. Returns how many there were, fewer than count if the trace ended first.
+    virtual long long skip(long long count);
+};
+
+//Source of raw trace bytes: a file, stdin or a pipe
+class ByteSource {
+public:
+    virtual ~ByteSource() {}
+
+    //Reads up to size bytes into buffer and returns how many were read, 0 at end of input.
+    //Throws std::runtime_error if the input cannot be read.
+    virtual std::size_t read(unsigned char* buffer, std::size_t size) = 0;
+};
+
+//Opens a trace file and picks the binary or text reader by looking at its first bytes.
+//Regular binary files are memory-mapped. Compressed (gzip, zstd, lz4) traces of either
+//format are decompressed on the fly, see Compression.h. "-" reads stdin, and named pipes
+//and other non-seekable inputs are streamed in fixed-size chunks, so memory use does not
+//depend on the length of the trace.
+//core_ids reads a third token of a text trace line as its core ID. Without it the token
+//is ignored and every text record is core 0, as for a single-core run.
+//Prints an error and returns nullptr if the file cannot be used.
+std::unique_ptr<TraceReader> openTrace(const std::string& filename, bool core_ids = true);
+
+//Builds a reader over an already opened byte stream, detecting the format from its first bytes
+std::unique_ptr<TraceReader> openTraceStream(std::unique_ptr<ByteSource> source, bool core_ids = true);
+
+//Converts a text trace ("R 0x1a000" or "R 0x1a000 3" per line) into the binary format.
+//The input is opened with openTrace, so it may also be compressed or come from stdin.
+//Returns false (after printing an error) on failure.
+bool convertTextTrace(const std::string& text_filename, const std::string& binary_filename);
+
+//Writes every record of reader to filename in the binary (CSTRACE2) or the text format and
+//sets record_count. Returns false (after printing an error) on failure.
+bool writeBinaryTrace(TraceReader& reader, const std::string& filename, unsigned long long& record_count);
+bool writeTextTrace(TraceReader& reader, const std::string& filename, unsigned long long& record_count);
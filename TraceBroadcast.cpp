@@ -0,0 +1,113 @@
+#include "TraceBroadcast.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct BroadcastChunk {
+    std::vector<TraceRecord> records;
+    std::size_t count = 0;
+    int readers_left = 0; //Workers that still have to release it
+};
+
+//Shared between the decoder and the workers, guarded by mutex
+struct BroadcastQueue {
+    std::mutex mutex;
+    std::condition_variable chunk_ready;
+    std::condition_variable chunk_free;
+    BroadcastChunk chunks[BROADCAST_CHUNKS_IN_FLIGHT];
+    unsigned long long published = 0; //Chunks handed to the workers so far
+    bool finished = false; //No more chunks will be published
+};
+
+
+bool TraceChunkReader::next(const TraceRecord*& records, std::size_t& count) {
+    release();
+
+    BroadcastChunk* chunk;
+    {
+        std::unique_lock<std::mutex> lock(queue_.mutex);
+        queue_.chunk_ready.wait(lock, [&] { return queue_.published > next_ || queue_.finished; });
+        if (queue_.published <= next_) {
+            return false; //Trace exhausted
+        }
+        chunk = &queue_.chunks[next_ % BROADCAST_CHUNKS_IN_FLIGHT];
+    }
+
+    //The chunk is read-only until every worker has released it
+    records = chunk->records.data();
+    count = chunk->count;
+    holding_ = true;
+    return true;
+}
+
+void TraceChunkReader::release() {
+    if (!holding_) {
+        return;
+    }
+    BroadcastChunk& chunk = queue_.chunks[next_ % BROADCAST_CHUNKS_IN_FLIGHT];
+    next_++;
+    holding_ = false;
+
+    std::lock_guard<std::mutex> lock(queue_.mutex);
+    if (--chunk.readers_left == 0) {
+        queue_.chunk_free.notify_one();
+    }
+}
+
+
+void broadcastTrace(TraceReader& trace, int workers,
+    const std::function<void(int worker, TraceChunkReader& reader)>& worker) {
+    BroadcastQueue queue;
+    for (BroadcastChunk& chunk : queue.chunks) {
+        chunk.records.resize(BROADCAST_CHUNK_RECORDS);
+    }
+
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w) {
+        pool.emplace_back([&queue, &worker, w] {
+            TraceChunkReader reader(queue);
+            worker(w, reader);
+        });
+    }
+
+    auto finish = [&] {
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.finished = true;
+            queue.chunk_ready.notify_all();
+        }
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+    };
+
+    //This thread is the decoder: it fills free slots in order and publishes them
+    try {
+        for (unsigned long long sequence = 0;; ++sequence) {
+            BroadcastChunk& chunk = queue.chunks[sequence % BROADCAST_CHUNKS_IN_FLIGHT];
+            {
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                queue.chunk_free.wait(lock, [&] { return chunk.readers_left == 0; });
+            }
+
+            std::size_t count = trace.read(chunk.records.data(), chunk.records.size());
+            if (count == 0) {
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            chunk.count = count;
+            chunk.readers_left = workers;
+            queue.published = sequence + 1;
+            queue.chunk_ready.notify_all();
+        }
+    }
+    catch (...) {
+        //A bad trace line: let the workers drain what was published, then report it
+        finish();
+        throw;
+    }
+    finish();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include "Trace.h"
+
+//Records per shared chunk. Big enough that the hand-off between the decoder and the
+//workers is noise, small enough that a few chunks fit in the host LLC.
+const std::size_t BROADCAST_CHUNK_RECORDS = 1 << 16;
+
+//Chunks in flight: the decoder fills one while the workers replay the others
+const int BROADCAST_CHUNKS_IN_FLIGHT = 4;
+
+struct BroadcastQueue;
+
+//A worker's view of the broadcast trace
+class TraceChunkReader {
+public:
+    explicit TraceChunkReader(BroadcastQueue& queue) : queue_(queue), next_(0), holding_(false) {}
+
+    //Releases the previous chunk and waits for the next one.
+    //Returns false once the whole trace has been handed out.
+    bool next(const TraceRecord*& records, std::size_t& count);
+
+private:
+    void release();
+
+    BroadcastQueue& queue_;
+    unsigned long long next_; //Sequence number of the next chunk to read
+    bool holding_;
+};
+
+//Decodes the trace once on the calling thread and hands every chunk, read-only and in
+//trace order, to each of the worker threads. worker(index, reader) runs on its own thread.
+//Memory stays at BROADCAST_CHUNKS_IN_FLIGHT chunks no matter how long the trace is.
+//Exceptions from the trace reader are rethrown after all workers have stopped.
+void broadcastTrace(TraceReader& trace, int workers,
+    const std::function<void(int worker, TraceChunkReader& reader)>& worker);
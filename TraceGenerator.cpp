@@ -0,0 +1,300 @@
+#include "TraceGenerator.h"
+
+#include <iostream>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+unsigned long long greatestCommonDivisor(unsigned long long a, unsigned long long b) {
+    while (b != 0) {
+        unsigned long long r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+//log1p(x) / x and expm1(x) / x, with their series near 0 where the quotients lose precision
+double log1pOverX(double x) {
+    return (std::fabs(x) > 1e-8) ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+double expm1OverX(double x) {
+    return (std::fabs(x) > 1e-8) ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+const long long BLOCK_BYTES = 64; //Granularity of ZIPFIAN and POINTER_CHASE
+const long long WORD_BYTES = 4; //Granularity of SEQUENTIAL and RANDOM
+
+} // namespace
+
+
+bool parseWorkloadPattern(const std::string& name, WorkloadPattern& pattern) {
+    std::string upper = toUpper(name);
+    const WorkloadPattern all[] = { WorkloadPattern::Mixed, WorkloadPattern::Sequential, WorkloadPattern::Strided,
+        WorkloadPattern::Zipfian, WorkloadPattern::PointerChase, WorkloadPattern::Random };
+    for (WorkloadPattern candidate : all) {
+        if (upper == workloadPatternName(candidate)) {
+            pattern = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported workload pattern " << name
+        << " (expected MIXED, SEQUENTIAL, STRIDED, ZIPFIAN, POINTER_CHASE or RANDOM)" << std::endl;
+    return false;
+}
+
+
+const char* workloadPatternName(WorkloadPattern pattern) {
+    switch (pattern) {
+    case WorkloadPattern::Mixed: return "MIXED";
+    case WorkloadPattern::Sequential: return "SEQUENTIAL";
+    case WorkloadPattern::Strided: return "STRIDED";
+    case WorkloadPattern::Zipfian: return "ZIPFIAN";
+    case WorkloadPattern::PointerChase: return "POINTER_CHASE";
+    case WorkloadPattern::Random: return "RANDOM";
+    }
+    return "unknown";
+}
+
+
+bool parseGeneratorOutput(const std::string& name, GeneratorOutput& output) {
+    std::string upper = toUpper(name);
+    const GeneratorOutput all[] = { GeneratorOutput::Text, GeneratorOutput::Binary, GeneratorOutput::Memory };
+    for (GeneratorOutput candidate : all) {
+        if (upper == generatorOutputName(candidate)) {
+            output = candidate;
+            return true;
+        }
+    }
+
+    std::cerr << "Error: Unsupported generator output " << name << " (expected TEXT, BINARY or MEMORY)" << std::endl;
+    return false;
+}
+
+
+const char* generatorOutputName(GeneratorOutput output) {
+    switch (output) {
+    case GeneratorOutput::Text: return "TEXT";
+    case GeneratorOutput::Binary: return "BINARY";
+    case GeneratorOutput::Memory: return "MEMORY";
+    }
+    return "unknown";
+}
+
+
+bool readWorkloadConfig(const Config& config, WorkloadConfig& workload) {
+    std::string pattern;
+    if (config.has("GENERATOR_PATTERN") && (!config.read("GENERATOR_PATTERN", pattern) || !parseWorkloadPattern(pattern, workload.pattern))) {
+        return false;
+    }
+    if (!config.read("GENERATOR_SEED", workload.seed)) {
+        return false;
+    }
+
+    struct IntKey {
+        const char* name;
+        long long* value;
+        long long minimum;
+        long long scale;
+    };
+    long long write_percent = workload.write_percent;
+    IntKey keys[] = { { "GENERATOR_ACCESSES", &workload.accesses, 0, 1 }, { "GENERATOR_FOOTPRINT_KB", &workload.footprint, 1, 1024 },
+        { "GENERATOR_STRIDE", &workload.stride, 1, 1 }, { "GENERATOR_WRITE_PERCENT", &write_percent, 0, 1 } };
+    for (const IntKey& key : keys) {
+        if (!config.has(key.name)) {
+            continue;
+        }
+        long long value = 0;
+        if (!config.read(key.name, value)) {
+            return false;
+        }
+        if (value < key.minimum) {
+            std::cerr << "Error: " << key.name << " must be at least " << key.minimum << "." << std::endl;
+            return false;
+        }
+        *key.value = value * key.scale;
+    }
+    if (write_percent > 100) {
+        std::cerr << "Error: GENERATOR_WRITE_PERCENT must be at most 100." << std::endl;
+        return false;
+    }
+    workload.write_percent = (int)write_percent;
+
+    if (!config.read("GENERATOR_ZIPF_ALPHA", workload.zipf_alpha)) {
+        return false;
+    }
+    if (!(workload.zipf_alpha > 0.0)) {
+        std::cerr << "Error: GENERATOR_ZIPF_ALPHA must be positive." << std::endl;
+        return false;
+    }
+
+    //The block numbers of the walks and the Zipf scatter are 32-bit
+    if (workload.footprint / BLOCK_BYTES > 0xFFFFFFFFLL) {
+        std::cerr << "Error: GENERATOR_FOOTPRINT_KB must be below 256 GB." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+TraceGenerator::TraceGenerator(const WorkloadConfig& workload)
+    : workload_(workload), engine_(workload.seed), produced_(0), blocks_(0), position_(0), hot_address_(0),
+      scatter_(1), zipf_integral_first_(0.0), zipf_integral_last_(0.0), zipf_s_(0.0) {
+    switch (workload_.pattern) {
+    case WorkloadPattern::Mixed:
+        //Temporal locality: the one word the writes go to
+        hot_address_ = 0x1A000 + below(20) * 4;
+        break;
+    case WorkloadPattern::Sequential:
+    case WorkloadPattern::Random:
+        blocks_ = (unsigned long long)(workload_.footprint / WORD_BYTES);
+        if (blocks_ == 0) {
+            blocks_ = 1;
+        }
+        break;
+    case WorkloadPattern::Strided:
+        break;
+    case WorkloadPattern::Zipfian: {
+        blocks_ = (unsigned long long)(workload_.footprint / BLOCK_BYTES);
+        if (blocks_ == 0) {
+            blocks_ = 1;
+        }
+        //Rank r goes to block r * scatter_ mod blocks_, a bijection since they are coprime
+        scatter_ = (unsigned long long)(blocks_ * 0.6180339887498949) | 1;
+        while (greatestCommonDivisor(scatter_, blocks_) != 1) {
+            scatter_ += 2;
+        }
+        scatter_ %= blocks_;
+        zipf_integral_first_ = zipfHIntegral(1.5) - 1.0;
+        zipf_integral_last_ = zipfHIntegral((double)blocks_ + 0.5);
+        zipf_s_ = 2.0 - zipfHIntegralInverse(zipfHIntegral(2.5) - zipfH(2.0));
+        break;
+    }
+    case WorkloadPattern::PointerChase: {
+        blocks_ = (unsigned long long)(workload_.footprint / BLOCK_BYTES);
+        if (blocks_ == 0) {
+            blocks_ = 1;
+        }
+        //Sattolo's shuffle: a uniformly random permutation that is a single cycle
+        next_block_.resize((std::size_t)blocks_);
+        for (std::size_t i = 0; i < next_block_.size(); ++i) {
+            next_block_[i] = (unsigned int)i;
+        }
+        for (std::size_t i = next_block_.size() - 1; i > 0; --i) {
+            std::size_t j = (std::size_t)below(i);
+            std::swap(next_block_[i], next_block_[j]);
+        }
+        break;
+    }
+    }
+}
+
+
+std::size_t TraceGenerator::read(TraceRecord* out, std::size_t max_records) {
+    std::size_t count = max_records;
+    if ((long long)count > workload_.accesses - produced_) {
+        count = (std::size_t)(workload_.accesses - produced_);
+    }
+
+    if (workload_.pattern == WorkloadPattern::Mixed) {
+        for (std::size_t i = 0; i < count; ++i) {
+            unsigned long long access_type = below(100);
+            if (access_type < 50) {
+                //50% chance: Spatial Locality
+                out[i].address = workload_.base_address + (unsigned long long)(produced_ + (long long)i) * 4;
+                out[i].access_type = 'R';
+            }
+            else if (access_type < 80) {
+                //30% chance: Temporal Locality
+                out[i].address = hot_address_;
+                out[i].access_type = 'W';
+            }
+            else {
+                //20% chance: Random Access
+                out[i].address = below(0xFFFF) * 4;
+                out[i].access_type = 'R';
+            }
+            out[i].core = 0;
+        }
+    }
+    else {
+        for (std::size_t i = 0; i < count; ++i) {
+            out[i].address = nextAddress();
+            out[i].access_type = (workload_.write_percent > 0 && below(100) < (unsigned long long)workload_.write_percent) ? 'W' : 'R';
+            out[i].core = 0;
+        }
+    }
+
+    produced_ += (long long)count;
+    return count;
+}
+
+
+unsigned long long TraceGenerator::nextAddress() {
+    unsigned long long offset = 0;
+    switch (workload_.pattern) {
+    case WorkloadPattern::Mixed:
+        break;
+    case WorkloadPattern::Sequential:
+        offset = position_ * WORD_BYTES;
+        position_ = (position_ + 1 == blocks_) ? 0 : position_ + 1;
+        break;
+    case WorkloadPattern::Strided:
+        offset = position_;
+        position_ = (position_ + (unsigned long long)workload_.stride) % (unsigned long long)workload_.footprint;
+        break;
+    case WorkloadPattern::Zipfian:
+        offset = ((zipfRank() - 1) * scatter_ % blocks_) * BLOCK_BYTES;
+        break;
+    case WorkloadPattern::PointerChase:
+        offset = position_ * BLOCK_BYTES;
+        position_ = next_block_[(std::size_t)position_];
+        break;
+    case WorkloadPattern::Random:
+        offset = below(blocks_) * WORD_BYTES;
+        break;
+    }
+    return workload_.base_address + offset;
+}
+
+
+//h(x) = x^-alpha, its integral H(x) = (x^(1 - alpha) - 1) / (1 - alpha) (log x for alpha = 1)
+//and the inverse of H
+double TraceGenerator::zipfH(double x) const {
+    return std::exp(-workload_.zipf_alpha * std::log(x));
+}
+
+double TraceGenerator::zipfHIntegral(double x) const {
+    double log_x = std::log(x);
+    return expm1OverX((1.0 - workload_.zipf_alpha) * log_x) * log_x;
+}
+
+double TraceGenerator::zipfHIntegralInverse(double x) const {
+    double t = x * (1.0 - workload_.zipf_alpha);
+    if (t < -1.0) {
+        t = -1.0; //Only reached through rounding
+    }
+    return std::exp(log1pOverX(t) * x);
+}
+
+
+unsigned long long TraceGenerator::zipfRank() {
+    while (true) {
+        double u = zipf_integral_last_ + uniform() * (zipf_integral_first_ - zipf_integral_last_);
+        double x = zipfHIntegralInverse(u);
+        double k = std::floor(x + 0.5);
+        if (k < 1.0) {
+            k = 1.0;
+        }
+        else if (k > (double)blocks_) {
+            k = (double)blocks_;
+        }
+        //Accept k right away when it is close enough to x, test it otherwise
+        if (k - x <= zipf_s_ || u >= zipfHIntegral(k + 0.5) - zipfH(k)) {
+            return (unsigned long long)k;
+        }
+    }
+}
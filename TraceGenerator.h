@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Config.h"
+#include "Trace.h"
+
+//Synthetic workloads.
+//
+//A TraceGenerator is a TraceReader that makes its accesses up as they are read, so the
+//simulator can run on it directly without a trace on disk, or it can be written out with
+//writeTextTrace / writeBinaryTrace. Every draw comes from one std::mt19937_64 seeded with
+//GENERATOR_SEED and is turned into numbers without the standard distributions (whose
+//output differs between standard libraries), so a seed gives the same trace everywhere.
+//  MIXED          the original test trace: 50% reads of consecutive words, 30% writes
+//                 to one hot word, 20% reads of random words in the first 256 KB
+//  SEQUENTIAL     consecutive 4-byte words, wrapping around the footprint
+//  STRIDED        steps of GENERATOR_STRIDE bytes, wrapping around the footprint
+//  ZIPFIAN        64-byte blocks of the footprint picked with Zipf(GENERATOR_ZIPF_ALPHA)
+//                 popularity, the hot ones scattered over the footprint
+//  POINTER_CHASE  one random cycle through every 64-byte block of the footprint, each
+//                 access depending on the last (a linked list walk)
+//  RANDOM         uniformly random 4-byte words of the footprint
+//Except for MIXED, GENERATOR_WRITE_PERCENT of the accesses are writes.
+
+enum class WorkloadPattern {
+    Mixed,
+    Sequential,
+    Strided,
+    Zipfian,
+    PointerChase,
+    Random
+};
+
+//Accepts MIXED, SEQUENTIAL, STRIDED, ZIPFIAN, POINTER_CHASE and RANDOM in any case.
+//Prints an error and returns false for anything else.
+bool parseWorkloadPattern(const std::string& name, WorkloadPattern& pattern);
+
+const char* workloadPatternName(WorkloadPattern pattern);
+
+//Where a generated workload goes
+enum class GeneratorOutput {
+    Text, //A text trace file (the original behaviour)
+    Binary, //A binary trace file
+    Memory //Straight into the simulator, nothing is written
+};
+
+bool parseGeneratorOutput(const std::string& name, GeneratorOutput& output);
+
+const char* generatorOutputName(GeneratorOutput output);
+
+struct WorkloadConfig {
+    WorkloadPattern pattern = WorkloadPattern::Mixed;
+    unsigned long long seed = 1;
+    long long accesses = 5000;
+    long long footprint = 256 * 1024; //Bytes
+    long long stride = 64; //Bytes, STRIDED only
+    double zipf_alpha = 0.99; //ZIPFIAN only
+    int write_percent = 0; //Not for MIXED
+    unsigned long long base_address = 0x10000;
+};
+
+//Reads the GENERATOR_ keys, leaving the defaults for missing ones.
+//Prints an error and returns false for a bad value.
+bool readWorkloadConfig(const Config& config, WorkloadConfig& workload);
+
+
+class TraceGenerator : public TraceReader {
+public:
+    //workload must have passed readWorkloadConfig (or hold the defaults)
+    explicit TraceGenerator(const WorkloadConfig& workload);
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override;
+
+    long long totalRecords() const override { return workload_.accesses; }
+
+private:
+    //Uniform in [0, bound)
+    unsigned long long below(unsigned long long bound) { return engine_() % bound; }
+
+    //Uniform in [0, 1)
+    double uniform() { return (double)(engine_() >> 11) * (1.0 / 9007199254740992.0); }
+
+    //Zipf rank in [1, blocks_], by rejection-inversion (Hormann and Derflinger, 1996),
+    //which takes O(1) time per draw for any number of blocks
+    unsigned long long zipfRank();
+    double zipfH(double x) const;
+    double zipfHIntegral(double x) const;
+    double zipfHIntegralInverse(double x) const;
+
+    unsigned long long nextAddress();
+
+    WorkloadConfig workload_;
+    std::mt19937_64 engine_;
+    long long produced_;
+    unsigned long long blocks_; //64-byte blocks (4-byte words for SEQUENTIAL and RANDOM) in the footprint
+    unsigned long long position_; //SEQUENTIAL, STRIDED and POINTER_CHASE: where the walk is
+    unsigned long long hot_address_; //MIXED
+    std::vector<unsigned int> next_block_; //POINTER_CHASE: the cycle
+    unsigned long long scatter_; //ZIPFIAN: odd multiplier coprime to blocks_ that spreads the ranks
+    double zipf_integral_first_; //ZIPFIAN: constants of the rejection-inversion sampler
+    double zipf_integral_last_;
+    double zipf_s_;
+};
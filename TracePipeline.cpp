@@ -0,0 +1,222 @@
+#include "TracePipeline.h"
+
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "SpscRing.h"
+
+namespace {
+
+struct PipelineChunk {
+    std::vector<TraceRecord> records;
+    std::size_t count = 0; //0 marks the end of the trace
+};
+
+class PipelinedTraceReader : public TraceReader {
+public:
+    explicit PipelinedTraceReader(std::unique_ptr<TraceReader> inner)
+        : inner_(std::move(inner)), total_records_(inner_->totalRecords()), ring_(PIPELINE_CHUNKS), current_(nullptr),
+          position_(0), finished_(false), stop_(false) {
+        for (PipelineChunk& chunk : ring_.slots()) {
+            chunk.records.resize(PIPELINE_CHUNK_RECORDS);
+        }
+        decoder_ = std::thread(&PipelinedTraceReader::decode, this);
+    }
+
+    ~PipelinedTraceReader() {
+        stop_.store(true, std::memory_order_relaxed);
+        ring_.wakeAll();
+        decoder_.join();
+    }
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override {
+        std::size_t count = 0;
+        while (count < max_records && !finished_) {
+            if (current_ == nullptr) {
+                int spins = 0;
+                while ((current_ = ring_.readSlot()) == nullptr) {
+                    ring_.waitForData(spins);
+                }
+                position_ = 0;
+                if (current_->count == 0) {
+                    //End of the trace, or the decoder hit a bad line
+                    finished_ = true;
+                    if (error_) {
+                        std::rethrow_exception(error_);
+                    }
+                    break;
+                }
+            }
+
+            std::size_t take = current_->count - position_;
+            if (take > max_records - count) take = max_records - count;
+            std::memcpy(out + count, current_->records.data() + position_, take * sizeof(TraceRecord));
+            count += take;
+            position_ += take;
+
+            if (position_ == current_->count) {
+                current_ = nullptr;
+                ring_.release();
+            }
+        }
+        return count;
+    }
+
+    //Taken before the decoder thread starts, which then owns inner_
+    long long totalRecords() const override { return total_records_; }
+
+private:
+    //Runs on the decoder thread
+    void decode() {
+        for (;;) {
+            PipelineChunk* chunk;
+            int spins = 0;
+            while ((chunk = ring_.writeSlot()) == nullptr) {
+                if (stop_.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                ring_.waitForSlot(spins);
+            }
+
+            try {
+                chunk->count = inner_->read(chunk->records.data(), chunk->records.size());
+            }
+            catch (...) {
+                //Published together with the end marker below
+                error_ = std::current_exception();
+                chunk->count = 0;
+            }
+            ring_.publish();
+
+            if (chunk->count == 0 || stop_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    std::unique_ptr<TraceReader> inner_;
+    long long total_records_;
+    SpscRing<PipelineChunk> ring_;
+    PipelineChunk* current_; //Chunk the consumer is reading from
+    std::size_t position_; //Next record in current_
+    bool finished_;
+    std::exception_ptr error_; //Written before the end marker is published
+    std::atomic<bool> stop_;
+    std::thread decoder_;
+};
+
+
+struct ByteChunk {
+    std::vector<unsigned char> bytes;
+    std::size_t size = 0; //Anything short of a full chunk marks the end of the input
+};
+
+class PipelinedByteSource : public ByteSource {
+public:
+    explicit PipelinedByteSource(std::unique_ptr<ByteSource> inner)
+        : inner_(std::move(inner)), ring_(PIPELINE_CHUNKS), current_(nullptr), position_(0),
+          finished_(false), stop_(false) {
+        for (ByteChunk& chunk : ring_.slots()) {
+            chunk.bytes.resize(PIPELINE_BYTE_CHUNK);
+        }
+        producer_ = std::thread(&PipelinedByteSource::produce, this);
+    }
+
+    ~PipelinedByteSource() {
+        stop_.store(true, std::memory_order_relaxed);
+        ring_.wakeAll();
+        producer_.join();
+    }
+
+    std::size_t read(unsigned char* buffer, std::size_t size) override {
+        if (finished_) {
+            return 0;
+        }
+        if (current_ == nullptr) {
+            int spins = 0;
+            while ((current_ = ring_.readSlot()) == nullptr) {
+                ring_.waitForData(spins);
+            }
+            position_ = 0;
+            if (current_->size == 0) {
+                finished_ = true;
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                return 0;
+            }
+        }
+
+        std::size_t take = current_->size - position_;
+        if (take > size) take = size;
+        std::memcpy(buffer, current_->bytes.data() + position_, take);
+        position_ += take;
+
+        if (position_ == current_->size) {
+            finished_ = (current_->size < current_->bytes.size());
+            current_ = nullptr;
+            ring_.release();
+        }
+        return take;
+    }
+
+private:
+    //Runs on the producer thread
+    void produce() {
+        for (;;) {
+            ByteChunk* chunk;
+            int spins = 0;
+            while ((chunk = ring_.writeSlot()) == nullptr) {
+                if (stop_.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                ring_.waitForSlot(spins);
+            }
+
+            try {
+                //Fill the whole chunk so the consumer sees few, large hand-offs
+                chunk->size = 0;
+                std::size_t got;
+                while (chunk->size < chunk->bytes.size() &&
+                    (got = inner_->read(chunk->bytes.data() + chunk->size, chunk->bytes.size() - chunk->size)) > 0) {
+                    chunk->size += got;
+                }
+            }
+            catch (...) {
+                error_ = std::current_exception();
+                chunk->size = 0;
+            }
+            //A short chunk means the input ended (or failed), it is the last one
+            bool last = (chunk->size < chunk->bytes.size());
+            ring_.publish();
+
+            if (last || stop_.load(std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    std::unique_ptr<ByteSource> inner_;
+    SpscRing<ByteChunk> ring_;
+    ByteChunk* current_;
+    std::size_t position_;
+    bool finished_;
+    std::exception_ptr error_;
+    std::atomic<bool> stop_;
+    std::thread producer_;
+};
+
+} // namespace
+
+
+std::unique_ptr<TraceReader> pipelineTrace(std::unique_ptr<TraceReader> inner) {
+    return std::unique_ptr<TraceReader>(new PipelinedTraceReader(std::move(inner)));
+}
+
+
+std::unique_ptr<ByteSource> pipelineBytes(std::unique_ptr<ByteSource> inner) {
+    return std::unique_ptr<ByteSource>(new PipelinedByteSource(std::move(inner)));
+}
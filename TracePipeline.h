@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+
+#include "Trace.h"
+
+//Chunks the decoder thread may run ahead of the simulator
+const int PIPELINE_CHUNKS = 4;
+
+//Records per pipeline chunk
+const std::size_t PIPELINE_CHUNK_RECORDS = 1 << 16;
+
+//Wraps a trace reader so that decoding runs on its own thread, one chunk ahead of the
+//simulation. The two threads hand chunks over through a lock-free SPSC ring, so memory stays
+//at PIPELINE_CHUNKS chunks however long the trace is. Decoding errors are rethrown from read().
+std::unique_ptr<TraceReader> pipelineTrace(std::unique_ptr<TraceReader> inner);
+
+//Bytes per chunk handed over by pipelineBytes
+const std::size_t PIPELINE_BYTE_CHUNK = 1 << 20;
+
+//Same idea for raw bytes: the inner source (typically a decompressor) runs on its own thread,
+//up to PIPELINE_CHUNKS chunks ahead of whoever reads the result.
+std::unique_ptr<ByteSource> pipelineBytes(std::unique_ptr<ByteSource> inner);
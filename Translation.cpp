@@ -0,0 +1,346 @@
+#include "Translation.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+//Typical L1 DTLB and STLB, for TLB_L1_ and TLB_L2_ keys that are not set
+const TlbLevelConfig DEFAULT_TLB_LEVELS[] = { { 64, 4 }, { 1536, 12 } };
+
+class TranslatingTraceReader : public TraceReader {
+public:
+    TranslatingTraceReader(std::unique_ptr<TraceReader> inner, AddressTranslator& translator)
+        : inner_(std::move(inner)), translator_(translator) {}
+
+    std::size_t read(TraceRecord* out, std::size_t max_records) override {
+        std::size_t count = inner_->read(out, max_records);
+        translator_.translate(out, count);
+        return count;
+    }
+
+    long long totalRecords() const override { return inner_->totalRecords(); }
+
+    //skip() reads through the records, so the pages they touch are still mapped in order
+
+private:
+    std::unique_ptr<TraceReader> inner_;
+    AddressTranslator& translator_;
+};
+
+} // namespace
+
+
+bool parsePageSize(const std::string& name, PageSize& page_size) {
+    std::string upper = toUpper(name);
+    const PageSize all[] = { PageSize::Page4K, PageSize::Page2M, PageSize::Page1G };
+    for (PageSize candidate : all) {
+        if (upper == pageSizeName(candidate)) {
+            page_size = candidate;
+            return true;
+        }
+    }
+    std::cerr << "Error: Unsupported page size " << name << " (expected 4K, 2M or 1G)" << std::endl;
+    return false;
+}
+
+
+const char* pageSizeName(PageSize page_size) {
+    switch (page_size) {
+    case PageSize::Page4K: return "4K";
+    case PageSize::Page2M: return "2M";
+    case PageSize::Page1G: return "1G";
+    }
+    return "unknown";
+}
+
+
+int pageSizeBits(PageSize page_size) {
+    switch (page_size) {
+    case PageSize::Page4K: return 12;
+    case PageSize::Page2M: return 21;
+    case PageSize::Page1G: return 30;
+    }
+    return 12;
+}
+
+
+bool parseFrameAllocation(const std::string& name, FrameAllocation& allocation) {
+    std::string upper = toUpper(name);
+    if (upper == "FIRST_TOUCH") {
+        allocation = FrameAllocation::FirstTouch;
+        return true;
+    }
+    if (upper == "RANDOM") {
+        allocation = FrameAllocation::Random;
+        return true;
+    }
+    std::cerr << "Error: Unsupported frame allocation " << name << " (expected FIRST_TOUCH or RANDOM)" << std::endl;
+    return false;
+}
+
+
+const char* frameAllocationName(FrameAllocation allocation) {
+    switch (allocation) {
+    case FrameAllocation::FirstTouch: return "FIRST_TOUCH";
+    case FrameAllocation::Random: return "RANDOM";
+    }
+    return "unknown";
+}
+
+
+bool readTranslationConfig(const Config& config, TranslationConfig& translation) {
+    if (!config.readFlag("TRANSLATION", translation.enabled)) {
+        return false;
+    }
+    if (!translation.enabled) {
+        return true;
+    }
+
+    //1. Pages and frames
+    std::string name;
+    if ((config.has("PAGE_SIZE") && (!config.read("PAGE_SIZE", name) || !parsePageSize(name, translation.page_size))) ||
+        (config.has("FRAME_ALLOCATION") && (!config.read("FRAME_ALLOCATION", name) || !parseFrameAllocation(name, translation.allocation))) ||
+        !config.read("FRAME_SEED", translation.seed) || !config.read("PHYSICAL_MEMORY_MB", translation.physical_memory_mb)) {
+        return false;
+    }
+    //At least one page, and physical addresses well inside 64 bits
+    const long long page_mb = (1LL << pageSizeBits(translation.page_size)) >> 20;
+    const long long minimum_mb = (page_mb > 0) ? page_mb : 1;
+    if (translation.physical_memory_mb < minimum_mb || translation.physical_memory_mb > (1LL << 32)) {
+        std::cerr << "Error: PHYSICAL_MEMORY_MB must be between " << minimum_mb << " and " << (1LL << 32)
+            << " for " << pageSizeName(translation.page_size) << " pages." << std::endl;
+        return false;
+    }
+
+    //2. The TLB levels
+    int levels = 2;
+    if (!config.read("TLB_LEVELS", levels)) {
+        return false;
+    }
+    if (levels < 1) {
+        std::cerr << "Error: TLB_LEVELS must be at least 1." << std::endl;
+        return false;
+    }
+    translation.tlb_levels.clear();
+    for (int n = 1; n <= levels; ++n) {
+        const std::string prefix = "TLB_L" + std::to_string(n) + "_";
+        TlbLevelConfig level;
+        if (n <= 2) {
+            level = DEFAULT_TLB_LEVELS[n - 1];
+        }
+        else if (!config.require(prefix + "ENTRIES") || !config.require(prefix + "ASSOCIATIVITY")) {
+            return false;
+        }
+        if (!config.read(prefix + "ENTRIES", level.entries) || !config.read(prefix + "ASSOCIATIVITY", level.associativity)) {
+            return false;
+        }
+        if (level.associativity < 1 || level.entries < level.associativity || level.entries % level.associativity != 0) {
+            std::cerr << "Error: " << prefix << "ENTRIES must be a positive multiple of " << prefix << "ASSOCIATIVITY." << std::endl;
+            return false;
+        }
+        translation.tlb_levels.push_back(level);
+    }
+    return true;
+}
+
+
+PageTable::PageTable(PageSize page_size, FrameAllocation allocation, unsigned long long frames, unsigned long long seed)
+    : levels_((VIRTUAL_ADDRESS_BITS - pageSizeBits(page_size)) / PAGE_TABLE_LEVEL_BITS),
+      entries_((std::size_t)1 << PAGE_TABLE_LEVEL_BITS, 0), allocation_(allocation), frames_(frames), next_frame_(0),
+      engine_(seed), mapped_pages_(0) {
+}
+
+
+unsigned long long PageTable::frame(unsigned long long page) {
+    const unsigned long long slot_mask = (1ULL << PAGE_TABLE_LEVEL_BITS) - 1;
+
+    //Walk down from the root, making the missing inner nodes on the way
+    std::size_t node = 0;
+    for (int level = levels_ - 1; level > 0; --level) {
+        std::size_t slot = (node << PAGE_TABLE_LEVEL_BITS) | (std::size_t)((page >> (level * PAGE_TABLE_LEVEL_BITS)) & slot_mask);
+        if (entries_[slot] == 0) {
+            entries_[slot] = (unsigned long long)nodes();
+            entries_.resize(entries_.size() + ((std::size_t)1 << PAGE_TABLE_LEVEL_BITS), 0);
+        }
+        node = (std::size_t)entries_[slot];
+    }
+
+    std::size_t slot = (node << PAGE_TABLE_LEVEL_BITS) | (std::size_t)(page & slot_mask);
+    if (entries_[slot] == 0) {
+        entries_[slot] = allocateFrame() + 1;
+        mapped_pages_++;
+    }
+    return entries_[slot] - 1;
+}
+
+
+unsigned long long PageTable::allocateFrame() {
+    if ((unsigned long long)mapped_pages_ == frames_) {
+        throw std::runtime_error("Physical memory is full: all " + std::to_string(frames_) +
+            " frames of PHYSICAL_MEMORY_MB are mapped");
+    }
+    if (allocation_ == FrameAllocation::FirstTouch) {
+        return next_frame_++;
+    }
+
+    //Redraw a taken frame. Fast until memory is nearly full, which a trace rarely gets to.
+    //The raw engine output is reduced by hand, like TraceGenerator::below: the standard
+    //distributions differ between standard libraries, and a seed must map the same pages
+    //to the same frames in every build.
+    for (;;) {
+        unsigned long long frame = engine_() % frames_;
+        if (used_frames_.insert(frame).second) {
+            return frame;
+        }
+    }
+}
+
+
+Tlb::Tlb(int entries, int associativity)
+    : ways_(associativity), index_((unsigned long long)(entries / associativity)), pages_((std::size_t)entries, 0),
+      frames_((std::size_t)entries, 0), last_used_((std::size_t)entries, 0), clock_(0) {
+}
+
+
+bool Tlb::lookup(unsigned long long page, unsigned long long& frame) {
+    unsigned long long set, tag;
+    index_.split(page, set, tag);
+    const std::size_t first = (std::size_t)set * (std::size_t)ways_;
+    for (std::size_t i = first; i < first + (std::size_t)ways_; ++i) {
+        if (pages_[i] == page + 1) {
+            frame = frames_[i];
+            last_used_[i] = ++clock_;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void Tlb::insert(unsigned long long page, unsigned long long frame) {
+    unsigned long long set, tag;
+    index_.split(page, set, tag);
+    const std::size_t first = (std::size_t)set * (std::size_t)ways_;
+
+    //An empty entry if there is one, else the least recently used
+    std::size_t victim = first;
+    for (std::size_t i = first; i < first + (std::size_t)ways_; ++i) {
+        if (pages_[i] == 0) {
+            victim = i;
+            break;
+        }
+        if (last_used_[i] < last_used_[victim]) {
+            victim = i;
+        }
+    }
+    pages_[victim] = page + 1;
+    frames_[victim] = frame;
+    last_used_[victim] = ++clock_;
+}
+
+
+AddressTranslator::AddressTranslator(const TranslationConfig& config, int cores, long long warmup_records)
+    : config_(config), page_bits_(pageSizeBits(config.page_size)),
+      page_table_(config.page_size, config.allocation, ((unsigned long long)config.physical_memory_mb << 20) >> page_bits_, config.seed),
+      stats_(config.tlb_levels.size()), warmup_left_(warmup_records) {
+    std::vector<Tlb> levels;
+    for (const TlbLevelConfig& level : config.tlb_levels) {
+        levels.push_back(Tlb(level.entries, level.associativity));
+    }
+    tlbs_.assign((std::size_t)((cores > 1) ? cores : 1), levels);
+}
+
+
+void AddressTranslator::translate(TraceRecord* records, std::size_t count) {
+    while (count > 0) {
+        //The counters are zeroed after every part of the warmup, so a trace that ends
+        //during it leaves nothing counted
+        std::size_t chunk = count;
+        if (warmup_left_ > 0 && (long long)chunk > warmup_left_) {
+            chunk = (std::size_t)warmup_left_;
+        }
+        for (std::size_t i = 0; i < chunk; ++i) {
+            std::size_t core = (tlbs_.size() == 1) ? 0 : records[i].core;
+            if (core >= tlbs_.size()) {
+                throw std::out_of_range("Core ID " + std::to_string(records[i].core) + " in the trace, but CORES is " +
+                    std::to_string(tlbs_.size()));
+            }
+            records[i].address = physicalAddress(records[i].address, tlbs_[core]);
+        }
+        if (warmup_left_ > 0) {
+            warmup_left_ -= (long long)chunk;
+            stats_.assign(stats_.size(), TlbStats());
+        }
+        records += chunk;
+        count -= chunk;
+    }
+}
+
+
+unsigned long long AddressTranslator::physicalAddress(unsigned long long address, std::vector<Tlb>& tlbs) {
+    //Bits 47 to 63 must be all zeros or all ones
+    const unsigned long long high = address >> (VIRTUAL_ADDRESS_BITS - 1);
+    if (high != 0 && high != (~0ULL >> (VIRTUAL_ADDRESS_BITS - 1))) {
+        std::ostringstream message;
+        message << "Address 0x" << std::hex << address << " is not a canonical " << std::dec << VIRTUAL_ADDRESS_BITS
+            << "-bit virtual address";
+        throw std::runtime_error(message.str());
+    }
+    const unsigned long long page = (address & ((1ULL << VIRTUAL_ADDRESS_BITS) - 1)) >> page_bits_;
+
+    //The first level that has the page, or a walk if none does
+    unsigned long long frame = 0;
+    std::size_t level = 0;
+    while (level < tlbs.size() && !tlbs[level].lookup(page, frame)) {
+        stats_[level].misses++;
+        level++;
+    }
+    if (level < tlbs.size()) {
+        stats_[level].hits++;
+    }
+    else {
+        frame = page_table_.frame(page);
+    }
+    for (std::size_t fill = 0; fill < level; ++fill) {
+        tlbs[fill].insert(page, frame);
+    }
+    return (frame << page_bits_) | (address & ((1ULL << page_bits_) - 1));
+}
+
+
+std::unique_ptr<TraceReader> translateTrace(std::unique_ptr<TraceReader> inner, AddressTranslator& translator) {
+    return std::unique_ptr<TraceReader>(new TranslatingTraceReader(std::move(inner), translator));
+}
+
+
+void printTranslationResults(const AddressTranslator& translator) {
+    const TranslationConfig& config = translator.config();
+    std::cout << "\n--- Translation Results ---" << std::endl;
+    std::cout << "Pages: " << pageSizeName(config.page_size) << ", " << frameAllocationName(config.allocation) << " frames" << std::endl;
+    std::cout << std::left << std::setw(7) << "Level" << std::setw(9) << "Entries" << std::setw(7) << "Ways"
+        << std::setw(14) << "Accesses" << std::setw(14) << "Hits" << std::setw(14) << "Misses" << "Miss Rate" << std::endl;
+    for (std::size_t i = 0; i < translator.stats().size(); ++i) {
+        const TlbLevelConfig& level = config.tlb_levels[i];
+        const TlbStats& stats = translator.stats()[i];
+        std::ostringstream miss_rate;
+        miss_rate << std::fixed << std::setprecision(4) << (stats.missRate() * 100.0) << "%";
+        std::cout << std::left << std::setw(7) << ("TLB" + std::to_string(i + 1)) << std::setw(9) << level.entries
+            << std::setw(7) << level.associativity << std::setw(14) << stats.accesses() << std::setw(14) << stats.hits
+            << std::setw(14) << stats.misses << miss_rate.str() << std::endl;
+    }
+    std::cout << std::right;
+
+    //Walks per thousand translations, and what the mapped pages and the table take up
+    const PageTable& table = translator.pageTable();
+    double walks_per_kilo = (translator.translations() == 0) ? 0.0 : translator.pageWalks() * 1000.0 / translator.translations();
+    std::cout << "Page Walks: " << translator.pageWalks() << " (" << std::fixed << std::setprecision(4) << walks_per_kilo
+        << " per 1000 accesses)" << std::endl;
+    std::cout << "Mapped Pages: " << table.mappedPages() << " ("
+        << ((table.mappedPages() << pageSizeBits(config.page_size)) >> 10) << " KB)" << std::endl;
+    std::cout << "Page Table: " << table.nodes() << " nodes, " << table.levels() << " levels, " << (table.bytes() >> 10)
+        << " KB" << std::endl;
+    std::cout << "---------------------------" << std::endl;
+}
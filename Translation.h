@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Config.h"
+#include "SetIndex.h"
+#include "Trace.h"
+
+//Virtual-to-physical address translation ahead of the caches.
+//
+//With TRANSLATION on, the trace addresses are virtual addresses of one 48-bit address space
+//(x86-64 canonical: bits 48 to 63 copy bit 47). Every record looks its page up in a TLB
+//hierarchy, and a miss of the last TLB level walks a radix page table. The first touch of
+//a page maps it to a physical frame, and the caches only ever see physical addresses.
+//
+//The page table has 512 entries per node, as on x86-64: four levels for 4K pages, three
+//for 2M and two for 1G. Nodes are only made for the parts of the address space the trace
+//touches, so a sparse 48-bit space costs a few KB per region, not a flat array.
+//
+//FRAME_ALLOCATION picks the frame of a new page:
+//  FIRST_TOUCH  the next free frame, so pages are laid out in the order they are touched
+//  RANDOM       a uniformly random free frame (seeded by FRAME_SEED), as on a long-running
+//               machine whose free memory is fragmented
+
+enum class PageSize {
+    Page4K,
+    Page2M,
+    Page1G
+};
+
+//Accepts 4K, 2M and 1G in any case.
+//Prints an error and returns false for anything else.
+bool parsePageSize(const std::string& name, PageSize& page_size);
+
+const char* pageSizeName(PageSize page_size);
+
+//log2 of the page size in bytes
+int pageSizeBits(PageSize page_size);
+
+enum class FrameAllocation {
+    FirstTouch,
+    Random
+};
+
+//Accepts FIRST_TOUCH and RANDOM in any case.
+//Prints an error and returns false for anything else.
+bool parseFrameAllocation(const std::string& name, FrameAllocation& allocation);
+
+const char* frameAllocationName(FrameAllocation allocation);
+
+//Bits of a virtual address, and bits of the page table index per level
+const int VIRTUAL_ADDRESS_BITS = 48;
+const int PAGE_TABLE_LEVEL_BITS = 9;
+
+struct TlbLevelConfig {
+    int entries = 0;
+    int associativity = 0; //entries for a fully-associative level
+};
+
+struct TranslationConfig {
+    bool enabled = false;
+    PageSize page_size = PageSize::Page4K;
+    FrameAllocation allocation = FrameAllocation::FirstTouch;
+    unsigned long long seed = 1; //RANDOM only
+    long long physical_memory_mb = 65536; //Frames to hand out
+    std::vector<TlbLevelConfig> tlb_levels; //TLB1 (the one looked up first) first
+};
+
+//Reads TRANSLATION, PAGE_SIZE, FRAME_ALLOCATION, FRAME_SEED, PHYSICAL_MEMORY_MB, TLB_LEVELS
+//and TLB_Ln_ENTRIES / TLB_Ln_ASSOCIATIVITY for each level. Levels 1 and 2 default to 64
+//entries 4-way and 1536 entries 12-way, a typical L1 DTLB and STLB.
+//Prints an error and returns false for a missing or bad value.
+bool readTranslationConfig(const Config& config, TranslationConfig& translation);
+
+
+//A radix page table over the virtual page numbers, filled as pages are first touched
+class PageTable {
+public:
+    PageTable(PageSize page_size, FrameAllocation allocation, unsigned long long frames, unsigned long long seed);
+
+    //The frame of virtual page number page, mapping it on its first touch.
+    //Throws std::runtime_error once every frame is taken.
+    unsigned long long frame(unsigned long long page);
+
+    int levels() const { return levels_; }
+    long long mappedPages() const { return mapped_pages_; }
+    long long nodes() const { return (long long)(entries_.size() >> PAGE_TABLE_LEVEL_BITS); }
+    long long bytes() const { return (long long)(entries_.size() * sizeof(unsigned long long)); }
+
+private:
+    unsigned long long allocateFrame();
+
+    int levels_;
+    //512 entries per node, node 0 is the root. An inner entry holds its child node, a leaf
+    //entry its frame + 1, and 0 is an empty entry either way (the root is nobody's child).
+    std::vector<unsigned long long> entries_;
+    FrameAllocation allocation_;
+    unsigned long long frames_;
+    unsigned long long next_frame_; //FIRST_TOUCH only
+    std::mt19937_64 engine_;
+    std::unordered_set<unsigned long long> used_frames_; //RANDOM only
+    long long mapped_pages_;
+};
+
+
+//One set-associative, LRU TLB level. Its sets are the page number modulo their number.
+class Tlb {
+public:
+    //entries is a multiple of associativity
+    Tlb(int entries, int associativity);
+
+    //On a hit sets frame, makes the entry the most recently used of its set and returns true
+    bool lookup(unsigned long long page, unsigned long long& frame);
+
+    //Adds a translation in place of the least recently used one of its set
+    void insert(unsigned long long page, unsigned long long frame);
+
+private:
+    int ways_;
+    ModuloIndex index_;
+    std::vector<unsigned long long> pages_; //page + 1, 0 for an empty entry
+    std::vector<unsigned long long> frames_;
+    std::vector<unsigned long long> last_used_; //clock_ at the last hit or insertion
+    unsigned long long clock_;
+};
+
+
+struct TlbStats {
+    long long hits = 0;
+    long long misses = 0;
+
+    long long accesses() const { return hits + misses; }
+    double missRate() const { return (accesses() == 0) ? 0.0 : (double)misses / accesses(); }
+};
+
+//The translation stage: a TLB hierarchy per core in front of one shared page table (the
+//cores run threads of one process). A level is only looked up on a miss of the level
+//before it, and a hit fills the levels before it. A page walk fills every level.
+class AddressTranslator {
+public:
+    //With more than one core, core i of the trace gets TLBs of its own. The first
+    //warmup_records translations are left out of the counters, see WARMUP_ACCESSES.
+    AddressTranslator(const TranslationConfig& config, int cores = 1, long long warmup_records = 0);
+
+    //Replaces the address of every record with its physical address.
+    //Throws std::runtime_error for a non-canonical address or once physical memory is full,
+    //and std::out_of_range for a core ID of CORES or above.
+    void translate(TraceRecord* records, std::size_t count);
+
+    const TranslationConfig& config() const { return config_; }
+    const PageTable& pageTable() const { return page_table_; }
+
+    //Summed over the cores, one per TLB level
+    const std::vector<TlbStats>& stats() const { return stats_; }
+    long long translations() const { return stats_.empty() ? 0 : stats_.front().accesses(); }
+    long long pageWalks() const { return stats_.empty() ? 0 : stats_.back().misses; }
+
+private:
+    unsigned long long physicalAddress(unsigned long long address, std::vector<Tlb>& tlbs);
+
+    TranslationConfig config_;
+    int page_bits_;
+    PageTable page_table_;
+    std::vector<std::vector<Tlb>> tlbs_; //Per core, then per level
+    std::vector<TlbStats> stats_;
+    long long warmup_left_;
+};
+
+//Wraps a trace reader so that every record it returns has been translated. Translation
+//runs on whichever thread reads, so behind pipelineTrace it runs on the decoder thread.
+//translator must outlive the reader.
+std::unique_ptr<TraceReader> translateTrace(std::unique_ptr<TraceReader> inner, AddressTranslator& translator);
+
+//The TLB hit and miss rates per level, the page walks and the page table size
+void printTranslationResults(const AddressTranslator& translator);
@@ -0,0 +1,59 @@
+#include "VictimCache.h"
+
+#include "Bits.h"
+#include "TagMatch.h"
+
+VictimCache::VictimCache(int blocks)
+    : blocks_(blocks, 0), last_used_(blocks, 0), valid_(0), dirty_(0), clock_(0) {}
+
+
+bool VictimCache::take(unsigned long long block, bool& dirty) {
+    unsigned long long hits = matchTags(blocks_.data(), (int)blocks_.size(), block) & valid_;
+    if (hits == 0) {
+        return false;
+    }
+    int entry = countTrailingZeros(hits);
+    dirty = (dirty_ >> entry) & 1;
+    valid_ &= ~(1ULL << entry);
+    dirty_ &= ~(1ULL << entry);
+    return true;
+}
+
+
+bool VictimCache::insert(unsigned long long block, bool dirty, unsigned long long& dropped, bool& dropped_dirty) {
+    const int count = (int)blocks_.size();
+    const unsigned long long all = (count == 64) ? ~0ULL : (1ULL << count) - 1;
+
+    //1. Use a free entry if there is one, otherwise the least recently used
+    int entry;
+    bool full = (valid_ == all);
+    if (!full) {
+        entry = countTrailingZeros(~valid_ & all);
+    }
+    else {
+        entry = 0;
+        for (int i = 1; i < count; ++i) {
+            if (last_used_[i] < last_used_[entry]) {
+                entry = i;
+            }
+        }
+        dropped = blocks_[entry];
+        dropped_dirty = (dirty_ >> entry) & 1;
+    }
+
+    //2. Put the block in
+    blocks_[entry] = block;
+    last_used_[entry] = ++clock_;
+    valid_ |= 1ULL << entry;
+    dirty_ = (dirty_ & ~(1ULL << entry)) | ((unsigned long long)dirty << entry);
+    return full;
+}
+
+
+void VictimCache::checkpoint(CheckpointFile& file) {
+    file.range(blocks_.data(), blocks_.size());
+    file.range(last_used_.data(), last_used_.size());
+    file.value(valid_);
+    file.value(dirty_);
+    file.value(clock_);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "Checkpoint.h"
+
+//A small fully-associative victim cache (Jouppi, 1990) behind a cache.
+//
+//Every block the cache evicts moves in here, clean or dirty, and a miss of the cache that
+//finds its block here swaps it back instead of fetching it from the next level. Only the
+//blocks this cache drops in turn leave for the next level, so it catches the conflict
+//misses of a few hot sets. With at most 64 blocks, one tag comparison (see TagMatch.h)
+//scans all of them.
+
+const int MAX_VICTIM_CACHE_BLOCKS = 64;
+
+class VictimCache {
+public:
+    //blocks is between 1 and MAX_VICTIM_CACHE_BLOCKS
+    explicit VictimCache(int blocks);
+
+    //Removes block (address >> offset bits) if it is held. Returns true if it was and sets
+    //dirty to whether it still had to be written back.
+    bool take(unsigned long long block, bool& dirty);
+
+    //Adds a block evicted from the cache as the most recently used one. Returns true if the
+    //least recently used block had to make room, which is then in dropped and dropped_dirty.
+    bool insert(unsigned long long block, bool dirty, unsigned long long& dropped, bool& dropped_dirty);
+
+    int blocks() const { return (int)blocks_.size(); }
+
+    //Saves or restores the entries, see Checkpoint.h
+    void checkpoint(CheckpointFile& file);
+
+private:
+    std::vector<unsigned long long> blocks_;
+    std::vector<unsigned long long> last_used_; //clock_ at the last insertion
+    unsigned long long valid_; //One bit per entry
+    unsigned long long dirty_;
+    unsigned long long clock_;
+};
@@ -1,273 +1,991 @@
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <vector>
-#include <map>
-#include <cmath>
-#include <iomanip>
-#include <climits>
-#include <random>
-#include <ctime>
-
-//Data Structure for a Cache Block
-struct CacheBlock {
-    bool valid;
-    unsigned long long tag;
-    int lru_counter; //Will store a timestamp of when it was last used
-
-    //Constructor to initialize a new block
-    CacheBlock() : valid(false), tag(0), lru_counter(0) {}
-};
-
-//Global variables
-std::vector<std::vector<CacheBlock>> cache; //The cache itself
-long long hits = 0;
-long long misses = 0;
-int global_time_counter = 0; //Our clock for LRU
-
-
-//This function reads the config file and returns a map of key-value pairs
-std::map<std::string, std::string> parseConfig(const std::string& filename) {
-    std::map<std::string, std::string> config;
-    std::ifstream configFile(filename);
-
-    if (!configFile.is_open()) {
-        std::cerr << "Error: Could not open config file " << filename << std::endl;
-        exit(1); //Exit if config file not found
-    }
-
-    std::string line;
-    while (std::getline(configFile, line)) {
-        //Use stringstream to split the line by the ':' separator
-        std::stringstream ss(line);
-        std::string key, value;
-
-        //Read the key
-        if (std::getline(ss, key, ':')) {
-            //Read the value
-            if (std::getline(ss, value)) {
-                //Trim leading whitespace from value
-                value.erase(0, value.find_first_not_of(" \t"));
-                //Store in the map as a string
-                config[key] = value;
-            }
-        }
-    }
-
-    configFile.close();
-    return config;
-}
-
-
-
-void accessCache(unsigned long long address, int offset_bits, int index_bits, int tag_bits) {
-    //Increment the global clock on every access
-    global_time_counter++;
-
-    //1. Calculate Tag and Index from the address
-
-    //Shift off the offset bits
-    unsigned long long address_no_offset = address >> offset_bits;
-
-    //Create a "mask" to extract the index bits
-    //If index_bits is 4, (1 << 4) is 10000. (1 << 4) - 1 is 01111.
-    unsigned long long index_mask = (1ULL << index_bits) - 1;
-
-    //Use the mask to get the index
-    unsigned long long index = address_no_offset & index_mask;
-
-    //The rest of the bits are the tag
-    unsigned long long tag = address_no_offset >> index_bits;
-
-    //2. Get the corresponding set from the cache
-    std::vector<CacheBlock>& set = cache[index];
-
-    //3. Check for a Hit
-    for (int i = 0; i < set.size(); ++i) {
-        if (set[i].valid && set[i].tag == tag) {
-            hits++;
-            //Update the LRU counter to show it was just used
-            set[i].lru_counter = global_time_counter;
-            return;
-        }
-    }
-
-    // 4. Handle a Miss
-    misses++;
-
-    // 5. Find a place to put the new block
-
-    //Try to find an "invalid" (empty) block
-    for (int i = 0; i < set.size(); ++i) {
-        if (!set[i].valid) {
-            //Found an empty slot. This is a miss.
-            set[i].valid = true;
-            set[i].tag = tag;
-            set[i].lru_counter = global_time_counter;
-            return;
-        }
-    }
-
-    // 6. If no invalid blocks, we must EVIC a block (LRU)
-
-    int lru_way = 0;
-    int min_lru_value = INT_MAX;
-
-    for (int i = 0; i < set.size(); ++i) {
-        if (set[i].lru_counter < min_lru_value) {
-            min_lru_value = set[i].lru_counter;
-            lru_way = i;
-        }
-    }
-
-	//Evict the LRU block and replace it
-    set[lru_way].valid = true; //It's now valid
-    set[lru_way].tag = tag; //With the new tag
-    set[lru_way].lru_counter = global_time_counter; //And the current time
-}
-
-
-void generateTrace() {
-    //Seed the random number generator
-    std::srand((unsigned int)std::time(nullptr));
-
-    //Create the trace file
-    std::ofstream trace_file("trace.txt");
-
-    int num_accesses = 5000;
-
-    //Create an address for temporal locality
-    unsigned long long hot_address = 0x1A000 + (std::rand() % 20) * 4;
-
-    for (int i = 0; i < num_accesses; ++i) {
-
-        int access_type = std::rand() % 100;
-        if (access_type < 50) {
-            //50% chance: Spatial Locality
-            //Access addresses 0x10000, 0x10004, 0x10008, etc.
-            unsigned long long address = 0x10000 + (i * 4);
-            trace_file << "R 0x" << std::hex << address << "\n";
-
-        }
-        else if (access_type < 80) {
-            //30% chance: Temporal Locality
-            trace_file << "W 0x" << std::hex << hot_address << "\n";
-
-        }
-        else {
-            //20% chance: Random Access
-            unsigned long long random_address = (std::rand() % 0xFFFF) * 4;
-            trace_file << "R 0x" << std::hex << random_address << "\n";
-        }
-    }
-
-    trace_file.close();
-    std::cout << "--- New 'trace.txt' generated with " << num_accesses << " accesses ---" << std::endl;
-}
-
-
-int main() {
-	//Generate a new trace file for testing
-    generateTrace();
-    //1. Parse the config file
-    std::map<std::string, std::string> config = parseConfig("config.ini");
-
-	//Print the config to verify
-    std::cout << "--- Configuration ---" << std::endl;
-    std::cout << "Cache Size: " << config["CACHE_SIZE_KB"] << " KB" << std::endl;
-    std::cout << "Block Size: " << config["BLOCK_SIZE_BYTES"] << " Bytes" << std::endl;
-    std::cout << "Associativity: " << config["ASSOCIATIVITY"] << std::endl;
-    std::cout << "---------------------" << std::endl;
-
-    //2. Calculate cache parameters
-    int cache_size = std::stoi(config["CACHE_SIZE_KB"]) * 1024; // Size in bytes
-    int block_size = std::stoi(config["BLOCK_SIZE_BYTES"]);
-    int associativity = std::stoi(config["ASSOCIATIVITY"]);
-
-    //Total number of blocks in the cache
-    int num_blocks = cache_size / block_size;
-
-    //Number of sets
-    //Add a check to prevent division by zero if associativity is 0
-    if (associativity == 0) {
-        std::cerr << "Error: Associativity cannot be zero." << std::endl;
-        return 1;
-    }
-    int num_sets = num_blocks / associativity;
-
-    //Add a check for num_sets being zero (e.g., cache size too small)
-    if (num_sets == 0) {
-        std::cerr << "Error: Number of sets is zero. Check cache/block size." << std::endl;
-        return 1;
-    }
-
-    // Number of bits needed for:
-    //the Offset (to find a byte within a block)
-    int offset_bits = (int)std::log2(block_size);
-    //the Index (to find the set)
-    int index_bits = (int)std::log2(num_sets);
-    //the Tag (the rest of the bits)
-    //Assume a 64-bit address space
-    int tag_bits = 64 - index_bits - offset_bits;
-
-	//Print the cache geometry
-    std::cout << "--- Cache Geometry ---" << std::endl;
-    std::cout << "Num Sets: " << num_sets << std::endl;
-    std::cout << "Offset Bits: " << offset_bits << std::endl;
-    std::cout << "Index Bits: " << index_bits << std::endl;
-    std::cout << "Tag Bits: " << tag_bits << std::endl;
-    std::cout << "----------------------" << std::endl;
-
-    //3. Initialize the cache data structure
-    //Resize the outer vector to the number of sets
-    cache.resize(num_sets);
-    for (int i = 0; i < num_sets; ++i) {
-        //Resize each inner vector to the associativity
-        cache[i].resize(associativity);
-    }
-
-    //4. Process the trace file
-    std::ifstream traceFile("trace.txt");
-    if (!traceFile.is_open()) {
-        std::cerr << "Error: Could not open trace file trace.txt" << std::endl;
-        return 1;
-    }
-
-    std::string line;
-    char access_type; //'R' or 'W'
-    std::string address_hex; //"0x..."
-
-    while (std::getline(traceFile, line)) {
-        std::stringstream ss(line);
-
-        //Parse the line: R 0x...
-        if (!(ss >> access_type >> address_hex)) {
-            continue; // Skip empty or bad lines
-        }
-
-        //Convert the hex address string to a number
-        unsigned long long address = std::stoull(address_hex, 0, 0);
-
-        //Call the simulator logic
-        accessCache(address, offset_bits, index_bits, tag_bits);
-    }
-
-    traceFile.close();
-
-    //5. Print the final results
-    std::cout << "\n--- Simulation Results ---" << std::endl;
-    long long total_accesses = hits + misses;
-    double hit_rate = (total_accesses == 0) ? 0.0 : (double)hits / total_accesses;
-
-    std::cout << "Total Accesses: " << total_accesses << std::endl;
-    std::cout << "Hits: " << hits << std::endl;
-    std::cout << "Misses: " << misses << std::endl;
-
-	//Format hit rate as a percentage with 4 decimal places
-    std::cout << "Hit Rate: " << std::fixed << std::setprecision(4)
-        << (hit_rate * 100.0) << "%" << std::endl;
-    std::cout << "--------------------------" << std::endl;
-
-    return 0;
-}
\ No newline at end of file
+#include <iostream>
+#include <cstdlib>
+#include <climits>
+#include <string>
+#include <vector>
+#include <utility>
+#include <iomanip>
+#include <thread>
+#include <algorithm>
+
+#include "Cache.h"
+#include "Checkpoint.h"
+#include "Coherence.h"
+#include "Config.h"
+#include "Hierarchy.h"
+#include "Partition.h"
+#include "Profile.h"
+#include "Progress.h"
+#include "Sampling.h"
+#include "StackDistance.h"
+#include "Sweep.h"
+#include "Trace.h"
+#include "TraceGenerator.h"
+#include "TracePipeline.h"
+#include "Translation.h"
+
+//Where the simulated accesses come from
+struct TraceInput {
+    std::string filename; //The trace file, unless the workload is generated in memory
+    bool in_memory = false;
+    WorkloadConfig workload;
+    TranslationConfig translation; //Virtual-to-physical translation, if enabled
+    bool core_ids = false; //Text traces name the core of each record (CORES above 1)
+
+    //For the mode banners
+    std::string name() const {
+        if (in_memory) {
+            return std::string("a generated ") + workloadPatternName(workload.pattern) + " workload";
+        }
+        return "'" + filename + "'";
+    }
+};
+
+
+//GENERATE_TRACE (1 by default, the simulator always made a fresh trace) generates a
+//synthetic workload from the GENERATOR_ keys, see TraceGenerator.h. GENERATOR_OUTPUT TEXT
+//(the default) or BINARY writes it to GENERATOR_FILE (default trace.txt) before the run,
+//MEMORY feeds it to the simulator in place of TRACE_FILE. 0 leaves the existing trace alone.
+bool prepareInput(const Config& config, TraceInput& input) {
+    //TRACE_FILE may name a text or a binary trace, the format is detected from the header.
+    //"-" reads the trace from stdin, and a named pipe works too.
+    input.filename = "trace.txt";
+    config.read("TRACE_FILE", input.filename);
+
+    //TRANSLATION: 1 takes the trace addresses as virtual ones, see Translation.h
+    if (!readTranslationConfig(config, input.translation)) {
+        return false;
+    }
+
+    bool generate = true;
+    if (!config.readFlag("GENERATE_TRACE", generate)) {
+        return false;
+    }
+    if (!generate) {
+        return true;
+    }
+    GeneratorOutput output = GeneratorOutput::Text;
+    std::string name;
+    if ((config.has("GENERATOR_OUTPUT") && (!config.read("GENERATOR_OUTPUT", name) || !parseGeneratorOutput(name, output))) ||
+        !readWorkloadConfig(config, input.workload)) {
+        return false;
+    }
+    if (output == GeneratorOutput::Memory) {
+        input.in_memory = true;
+        std::cout << "--- Generating " << input.workload.accesses << " " << workloadPatternName(input.workload.pattern)
+            << " accesses in memory (seed " << input.workload.seed << ") ---" << std::endl;
+        return true;
+    }
+
+    std::string filename = "trace.txt";
+    config.read("GENERATOR_FILE", filename);
+    TraceGenerator generator(input.workload);
+    unsigned long long count = 0;
+    bool written = (output == GeneratorOutput::Binary) ? writeBinaryTrace(generator, filename, count)
+        : writeTextTrace(generator, filename, count);
+    if (!written) {
+        return false;
+    }
+    std::cout << "--- New '" << filename << "' generated with " << count << " accesses ---" << std::endl;
+    return true;
+}
+
+
+std::unique_ptr<TraceReader> openInput(const TraceInput& input) {
+    if (input.in_memory) {
+        return std::unique_ptr<TraceReader>(new TraceGenerator(input.workload));
+    }
+    return openTrace(input.filename, input.core_ids);
+}
+
+
+//Puts the translation stage of input, if it has one, in front of trace, with a TLB
+//hierarchy per core. The translator stays with the caller for the results.
+std::unique_ptr<AddressTranslator> translateInput(const TraceInput& input, std::unique_ptr<TraceReader>& trace, int cores,
+    long long warmup_accesses = 0) {
+    if (!input.translation.enabled) {
+        return nullptr;
+    }
+    const TranslationConfig& translation = input.translation;
+    std::cout << "Translation: " << pageSizeName(translation.page_size) << " pages, " << frameAllocationName(translation.allocation)
+        << " frames from " << translation.physical_memory_mb << " MB";
+    for (std::size_t i = 0; i < translation.tlb_levels.size(); ++i) {
+        std::cout << ", TLB" << (i + 1) << " " << translation.tlb_levels[i].entries << " entries "
+            << translation.tlb_levels[i].associativity << "-way";
+    }
+    std::cout << ((cores > 1) ? " per core" : "") << std::endl;
+
+    std::unique_ptr<AddressTranslator> translator(new AddressTranslator(translation, cores, warmup_accesses));
+    trace = translateTrace(std::move(trace), *translator);
+    return translator;
+}
+
+
+//What the simulation loop does besides simulating, all optional
+struct RunOptions {
+    long long warmup_accesses = 0; //Records at the start of the trace left out of the counters
+    IntervalLog* intervals = nullptr; //Intervals are counted from the end of the warmup
+    ProgressMeter* progress = nullptr; //Gets the totals after every batch
+    std::string checkpoint_filename; //Saved every checkpoint_accesses accesses if that is above 0
+    long long checkpoint_accesses = 0;
+};
+
+
+//Runs the rest of the trace through one cache, starting first_access records into it. The
+//batches are split at the end of the warmup, where the counters are zeroed, and at the
+//interval and checkpoint boundaries, which are multiples of their length counted from the
+//end of the warmup and from the start of the trace. accesses is set to where the trace ended.
+//Returns false (after printing an error) if a checkpoint could not be saved.
+bool simulateTrace(TraceReader& trace, Cache& cache, long long first_access, const RunOptions& options, long long& accesses) {
+    //Decode the trace in batches so the hot loop never allocates
+    std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+    std::size_t batch_count;
+    accesses = first_access;
+
+    //Next boundary of each, -1 for none. A run resumed past the warmup has nothing to drop.
+    const long long warmup = options.warmup_accesses;
+    const long long interval = (options.intervals != nullptr) ? options.intervals->interval() : 0;
+    const long long checkpoint_interval = options.checkpoint_filename.empty() ? 0 : options.checkpoint_accesses;
+    long long warmup_end = (warmup > first_access) ? warmup : -1;
+    long long next_snapshot = (interval > 0) ? warmup + (std::max(first_access - warmup, 0LL) / interval + 1) * interval : -1;
+    long long next_checkpoint = (checkpoint_interval > 0) ? (first_access / checkpoint_interval + 1) * checkpoint_interval : -1;
+
+    while ((batch_count = trace.read(batch.data(), batch.size())) > 0) {
+        std::size_t done = 0;
+        while (done < batch_count) {
+            std::size_t count = batch_count - done;
+            for (long long boundary : { warmup_end, next_snapshot, next_checkpoint }) {
+                if (boundary >= 0 && (long long)count > boundary - accesses) {
+                    count = (std::size_t)(boundary - accesses);
+                }
+            }
+            //Call the simulator logic
+            cache.access(batch.data() + done, count);
+            done += count;
+            accesses += (long long)count;
+
+            //The warmup only fills the cache
+            if (accesses == warmup_end) {
+                cache.resetStats();
+                if (options.intervals != nullptr) {
+                    options.intervals->start(accesses, 0, 0);
+                }
+                warmup_end = -1;
+            }
+            if (accesses == next_snapshot) {
+                options.intervals->snapshot(accesses, cache.stats().hits, cache.stats().misses);
+                next_snapshot += interval;
+            }
+            if (accesses == next_checkpoint) {
+                if (!cache.saveCheckpoint(options.checkpoint_filename, accesses)) {
+                    return false;
+                }
+                next_checkpoint += checkpoint_interval;
+            }
+        }
+        if (options.progress != nullptr) {
+            options.progress->update(accesses, cache.stats().hits, cache.stats().misses);
+        }
+    }
+
+    //A trace too short to warm the cache up leaves nothing to count
+    if (warmup_end >= 0) {
+        cache.resetStats();
+        if (options.intervals != nullptr) {
+            options.intervals->start(accesses, 0, 0);
+        }
+    }
+    return true;
+}
+
+
+//Number of threads "use every core" stands for
+int hardwareThreads() {
+    int threads = (int)std::thread::hardware_concurrency();
+    return (threads > 0) ? threads : 1;
+}
+
+
+//Sweep mode: one cache per line of the sweep file, all fed from one decode of the trace
+int runSweepMode(const std::string& sweep_filename, const TraceInput& input, int threads) {
+    std::vector<SweepPoint> points;
+    if (!parseSweepFile(sweep_filename, points) || !prepareSweep(points)) {
+        return 1;
+    }
+
+    if (threads <= 0) {
+        threads = hardwareThreads();
+    }
+    std::cout << "--- Sweeping " << points.size() << " configurations over " << input.name()
+        << " with " << threads << " thread(s) ---" << std::endl;
+
+    std::unique_ptr<TraceReader> trace = openInput(input);
+    if (!trace) {
+        return 1;
+    }
+    std::unique_ptr<AddressTranslator> translator = translateInput(input, trace, 1);
+
+    std::vector<CacheStats> results;
+    try {
+        results = runSweep(*trace, points, threads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    printSweepResults(points, results);
+    if (translator) {
+        printTranslationResults(*translator);
+    }
+    return 0;
+}
+
+
+//Stack distance mode: LRU hit rates of every associativity for each set count, in one pass
+int runStackDistanceMode(const std::vector<int>& set_counts, int block_size, const TraceInput& input,
+    const std::string& csv_filename, int threads) {
+    if (block_size <= 0 || (block_size & (block_size - 1)) != 0) {
+        std::cerr << "Error: Block size must be a power of two." << std::endl;
+        return 1;
+    }
+    for (int sets : set_counts) {
+        if (sets <= 0 || (sets & (sets - 1)) != 0) {
+            std::cerr << "Error: Number of sets must be a power of two, got " << sets << std::endl;
+            return 1;
+        }
+    }
+
+    if (threads <= 0) {
+        threads = hardwareThreads();
+    }
+    std::cout << "--- Stack distance analysis of " << input.name() << " for " << set_counts.size()
+        << " set count(s) with " << block_size << "B blocks ---" << std::endl;
+
+    std::unique_ptr<TraceReader> trace = openInput(input);
+    if (!trace) {
+        return 1;
+    }
+    std::unique_ptr<AddressTranslator> translator = translateInput(input, trace, 1);
+
+    std::vector<StackDistanceCurve> curves;
+    try {
+        if (set_counts.size() == 1 && threads > 1) {
+            trace = pipelineTrace(std::move(trace));
+        }
+        curves = runStackDistance(*trace, set_counts, block_size, threads);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    for (const StackDistanceCurve& curve : curves) {
+        printStackDistanceCurve(curve);
+    }
+    if (translator) {
+        printTranslationResults(*translator);
+    }
+    if (!csv_filename.empty() && !writeStackDistanceCsv(csv_filename, curves)) {
+        return 1;
+    }
+    return 0;
+}
+
+
+//Hierarchy mode: L1..Ln from config.ini, each level fed the misses of the one above it
+int runHierarchyMode(const std::vector<LevelConfig>& levels, const TraceInput& input, bool decode_thread) {
+    std::cout << "--- Hierarchy ---" << std::endl;
+    for (const LevelConfig& level : levels) {
+        std::cout << level.name << ": " << level.cache_size_kb << " KB, " << level.geometry.block_size << "B blocks, "
+            << level.geometry.associativity << "-way, " << replacementPolicyName(level.policy);
+        if (&level != &levels.front()) {
+            std::cout << ", " << inclusionName(level.inclusion);
+        }
+        std::cout << ", " << writePolicyName(level.write_policy) << ", " << writeMissPolicyName(level.write_miss_policy);
+        if (level.index.function != IndexFunction::Modulo) {
+            std::cout << ", " << indexFunctionName(level.index.function) << " index";
+        }
+        if (level.prefetch.kind != PrefetcherKind::None) {
+            std::cout << ", " << prefetcherKindName(level.prefetch.kind) << " prefetch x" << level.prefetch.degree;
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "-----------------" << std::endl;
+
+    std::unique_ptr<TraceReader> trace = openInput(input);
+    if (!trace) {
+        return 1;
+    }
+    std::unique_ptr<AddressTranslator> translator = translateInput(input, trace, 1);
+
+    CacheHierarchy hierarchy(levels);
+    try {
+        if (decode_thread) {
+            trace = pipelineTrace(std::move(trace));
+        }
+        std::vector<TraceRecord> batch(HIERARCHY_BATCH_SIZE);
+        std::size_t batch_count;
+        while ((batch_count = trace->read(batch.data(), batch.size())) > 0) {
+            hierarchy.access(batch.data(), batch_count);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    printHierarchyResults(hierarchy, levels);
+    if (translator) {
+        printTranslationResults(*translator);
+    }
+    return 0;
+}
+
+
+//Multi-core mode: a private L1 per core from the L1 keys, an optional shared L2, coherent
+int runMultiCoreMode(const std::vector<LevelConfig>& levels, int cores, CoherenceProtocol protocol,
+    const TraceInput& input, bool decode_thread) {
+    std::cout << "--- Multi-Core ---" << std::endl;
+    std::cout << "Cores: " << cores << ", " << coherenceProtocolName(protocol) << std::endl;
+    for (const LevelConfig& level : levels) {
+        std::cout << level.name << ": " << level.cache_size_kb << " KB, " << level.geometry.block_size << "B blocks, "
+            << level.geometry.associativity << "-way, " << replacementPolicyName(level.policy);
+        if (&level != &levels.front()) {
+            std::cout << ", shared, " << inclusionName(level.inclusion);
+        }
+        else {
+            std::cout << ", private";
+        }
+        if (level.index.function != IndexFunction::Modulo) {
+            std::cout << ", " << indexFunctionName(level.index.function) << " index";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "------------------" << std::endl;
+
+    std::unique_ptr<TraceReader> trace = openInput(input);
+    if (!trace) {
+        return 1;
+    }
+    std::unique_ptr<AddressTranslator> translator = translateInput(input, trace, cores);
+
+    CoherentSystem system(levels, cores, protocol);
+    try {
+        if (decode_thread) {
+            trace = pipelineTrace(std::move(trace));
+        }
+        std::vector<TraceRecord> batch(TRACE_BATCH_SIZE);
+        std::size_t batch_count;
+        while ((batch_count = trace->read(batch.data(), batch.size())) > 0) {
+            system.access(batch.data(), batch_count);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    printCoherenceResults(system, levels);
+    if (translator) {
+        printTranslationResults(*translator);
+    }
+    return 0;
+}
+
+
+//The keys of the single cache mode, read and checked before anything is simulated
+struct CacheRunConfig {
+    long long cache_size_kb = 0;
+    int block_size = 0;
+    int associativity = 0;
+    ReplacementPolicy policy = ReplacementPolicy::Lru;
+    WritePolicy write_policy = WritePolicy::WriteBack;
+    WriteMissPolicy write_miss_policy = WriteMissPolicy::WriteAllocate;
+    IndexConfig index;
+    PrefetchConfig prefetch;
+    bool classify_misses = false;
+    int victim_blocks = 0;
+    std::string profile_filename; //Empty for no profile
+    ProfileFormat profile_format = ProfileFormat::Json;
+    int profile_top_evicted = 16;
+    long long interval_accesses = 0;
+    IntervalFormat interval_format = IntervalFormat::Csv;
+    std::string interval_filename;
+    double progress_seconds = 0.0;
+    std::string checkpoint_filename;
+    long long checkpoint_accesses = 0;
+    std::string resume_filename;
+    ResumeMode resume_mode = ResumeMode::Continue;
+    long long warmup_accesses = 0;
+    int partition_threads = 1;
+    double sample_rate = 1.0;
+
+    //Features that need the whole cache in one engine
+    bool needsWholeCache() const {
+        return prefetch.kind != PrefetcherKind::None || classify_misses || victim_blocks > 0 || !profile_filename.empty() ||
+            interval_accesses > 0 || progress_seconds > 0.0 || !checkpoint_filename.empty() || !resume_filename.empty() ||
+            warmup_accesses > 0;
+    }
+};
+
+
+//Reads the single cache keys into run. Everything that does not depend on the geometry
+//is checked here. Prints an error and returns false for a missing or bad value.
+bool readCacheRunConfig(const Config& config, CacheRunConfig& run) {
+    //1. The cache itself
+    if (!readCacheShape(config, "", run.cache_size_kb, run.block_size, run.associativity)) {
+        return false;
+    }
+    std::string name;
+    if ((config.has("REPLACEMENT_POLICY") && (!config.read("REPLACEMENT_POLICY", name) || !parseReplacementPolicy(name, run.policy))) ||
+        //WRITE_POLICY and WRITE_MISS_POLICY decide what the 'W' accesses of the trace do
+        (config.has("WRITE_POLICY") && (!config.read("WRITE_POLICY", name) || !parseWritePolicy(name, run.write_policy))) ||
+        (config.has("WRITE_MISS_POLICY") && (!config.read("WRITE_MISS_POLICY", name) || !parseWriteMissPolicy(name, run.write_miss_policy)))) {
+        return false;
+    }
+
+    //INDEX_FUNCTION (and INDEX_HASH_MASKS) pick how an address finds its set, see SetIndex.h
+    if (!readIndexConfig(config, "", run.index)) {
+        return false;
+    }
+
+    //PREFETCHER and the PREFETCH_ keys put a prefetcher on the miss path
+    if (!readPrefetchConfig(config, "", run.prefetch)) {
+        return false;
+    }
+
+    //CLASSIFY_MISSES: 1 splits the misses into compulsory, capacity and conflict ones.
+    //VICTIM_CACHE_BLOCKS puts a small fully-associative victim cache behind the cache.
+    if (!config.readFlag("CLASSIFY_MISSES", run.classify_misses) || !config.read("VICTIM_CACHE_BLOCKS", run.victim_blocks)) {
+        return false;
+    }
+    if (run.victim_blocks < 0 || run.victim_blocks > MAX_VICTIM_CACHE_BLOCKS) {
+        std::cerr << "Error: VICTIM_CACHE_BLOCKS must be between 0 and " << MAX_VICTIM_CACHE_BLOCKS << "." << std::endl;
+        return false;
+    }
+    if (run.victim_blocks > 0 && run.prefetch.kind != PrefetcherKind::None) {
+        std::cerr << "Error: VICTIM_CACHE_BLOCKS cannot be combined with PREFETCHER." << std::endl;
+        return false;
+    }
+    if (run.index.function == IndexFunction::Skewed && (run.prefetch.kind != PrefetcherKind::None || run.victim_blocks > 0)) {
+        std::cerr << "Error: INDEX_FUNCTION SKEWED cannot be combined with PREFETCHER or VICTIM_CACHE_BLOCKS." << std::endl;
+        return false;
+    }
+
+    //2. What the run writes besides the results
+    //PROFILE_FILE writes per-set counters, reuse distances and the PROFILE_TOP_EVICTED most
+    //evicted blocks as PROFILE_FORMAT (JSON or CSV). Needs a build with CACHESIM_PROFILE.
+    if (!config.read("PROFILE_FILE", run.profile_filename) || !config.read("PROFILE_TOP_EVICTED", run.profile_top_evicted) ||
+        (config.has("PROFILE_FORMAT") && (!config.read("PROFILE_FORMAT", name) || !parseProfileFormat(name, run.profile_format)))) {
+        return false;
+    }
+    if (run.profile_top_evicted < 0) {
+        std::cerr << "Error: PROFILE_TOP_EVICTED cannot be negative." << std::endl;
+        return false;
+    }
+#ifndef CACHESIM_PROFILE
+    if (!run.profile_filename.empty()) {
+        std::cerr << "Error: PROFILE_FILE needs a build with CACHESIM_PROFILE defined." << std::endl;
+        return false;
+    }
+#endif
+    //The profile names the set of a block by the modulo index
+    if (!run.profile_filename.empty() && run.index.function != IndexFunction::Modulo) {
+        std::cerr << "Error: PROFILE_FILE needs INDEX_FUNCTION MODULO." << std::endl;
+        return false;
+    }
+
+    //INTERVAL_ACCESSES records the hits and misses of every that many accesses to
+    //INTERVAL_FILE as INTERVAL_FORMAT (CSV or BINARY). PROGRESS_SECONDS prints a progress
+    //line that often. 0 turns either off.
+    if (!config.read("INTERVAL_ACCESSES", run.interval_accesses) || !config.read("PROGRESS_SECONDS", run.progress_seconds) ||
+        (config.has("INTERVAL_FORMAT") && (!config.read("INTERVAL_FORMAT", name) || !parseIntervalFormat(name, run.interval_format)))) {
+        return false;
+    }
+    run.interval_filename = (run.interval_format == IntervalFormat::Csv) ? "intervals.csv" : "intervals.bin";
+    config.read("INTERVAL_FILE", run.interval_filename);
+    if (run.interval_accesses < 0 || run.progress_seconds < 0.0) {
+        std::cerr << "Error: INTERVAL_ACCESSES and PROGRESS_SECONDS cannot be negative." << std::endl;
+        return false;
+    }
+
+    //CHECKPOINT_FILE saves the cache and the position in the trace at the end of the run,
+    //and every CHECKPOINT_ACCESSES accesses if that is above 0. RESUME_FILE restores such a
+    //checkpoint first. RESUME_MODE CONTINUE (the default) carries on where it stopped, WARM
+    //runs the whole trace on its contents with fresh counters.
+    if (!config.read("CHECKPOINT_FILE", run.checkpoint_filename) || !config.read("CHECKPOINT_ACCESSES", run.checkpoint_accesses) ||
+        !config.read("RESUME_FILE", run.resume_filename) ||
+        (config.has("RESUME_MODE") && (!config.read("RESUME_MODE", name) || !parseResumeMode(name, run.resume_mode)))) {
+        return false;
+    }
+    if (run.checkpoint_accesses < 0) {
+        std::cerr << "Error: CHECKPOINT_ACCESSES cannot be negative." << std::endl;
+        return false;
+    }
+
+    //WARMUP_ACCESSES simulates that many records at the start of the trace without counting
+    //them. After a WARM resume that is the start of the measurement trace.
+    if (!config.read("WARMUP_ACCESSES", run.warmup_accesses)) {
+        return false;
+    }
+    if (run.warmup_accesses < 0) {
+        std::cerr << "Error: WARMUP_ACCESSES cannot be negative." << std::endl;
+        return false;
+    }
+    bool checkpoints = !run.checkpoint_filename.empty() || !run.resume_filename.empty();
+    if (checkpoints && (run.prefetch.kind != PrefetcherKind::None || run.classify_misses || !run.profile_filename.empty() ||
+        run.index.function == IndexFunction::Skewed)) {
+        std::cerr << "Error: CHECKPOINT_FILE and RESUME_FILE cannot be combined with PREFETCHER, CLASSIFY_MISSES, PROFILE_FILE "
+            << "or INDEX_FUNCTION SKEWED." << std::endl;
+        return false;
+    }
+
+    //3. How to run it
+    //PARTITION_THREADS splits the sets of this one cache over several threads (0 = every core).
+    //SAMPLE_RATE below 1 simulates only that fraction of the sets and estimates the rest.
+    if (!config.read("PARTITION_THREADS", run.partition_threads) || !config.read("SAMPLE_RATE", run.sample_rate)) {
+        return false;
+    }
+    if (run.partition_threads <= 0) {
+        run.partition_threads = hardwareThreads();
+    }
+    if (run.sample_rate <= 0.0) {
+        std::cerr << "Error: SAMPLE_RATE must be positive." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
+//Single cache mode: the cache of run over the trace, on one engine, set-partitioned or sampled
+int runCacheMode(const CacheRunConfig& run, const TraceInput& input, bool decode_thread) {
+	//Print the config to verify
+    std::cout << "--- Configuration ---" << std::endl;
+    std::cout << "Cache Size: " << run.cache_size_kb << " KB" << std::endl;
+    std::cout << "Block Size: " << run.block_size << " Bytes" << std::endl;
+    std::cout << "Associativity: " << run.associativity << std::endl;
+    std::cout << "Replacement Policy: " << replacementPolicyName(run.policy) << std::endl;
+    std::cout << "Write Policy: " << writePolicyName(run.write_policy) << ", " << writeMissPolicyName(run.write_miss_policy) << std::endl;
+    std::cout << "---------------------" << std::endl;
+    if (run.prefetch.kind != PrefetcherKind::None) {
+        std::cout << "Prefetcher: " << prefetcherKindName(run.prefetch.kind) << ", degree " << run.prefetch.degree << std::endl;
+    }
+    if (run.victim_blocks > 0) {
+        std::cout << "Victim Cache: " << run.victim_blocks << " blocks" << std::endl;
+    }
+
+    //1. Calculate cache parameters
+    CacheGeometry geometry;
+    if (!computeGeometry(run.cache_size_kb * 1024, run.block_size, run.associativity, geometry) ||
+        !checkIndexConfig(run.index, geometry, run.policy)) {
+        return 1;
+    }
+
+	//Print the cache geometry
+    std::cout << "--- Cache Geometry ---" << std::endl;
+    std::cout << "Num Sets: " << geometry.num_sets << std::endl;
+    std::cout << "Offset Bits: " << geometry.offset_bits << std::endl;
+    if (geometry.powerOfTwoSets()) {
+        std::cout << "Index Bits: " << geometry.index_bits << std::endl;
+    }
+    else {
+        std::cout << "Index: block modulo " << geometry.num_sets << std::endl;
+    }
+    std::cout << "Tag Bits: " << geometry.tag_bits << std::endl;
+    if (run.index.function != IndexFunction::Modulo) {
+        std::cout << "Index Function: " << indexFunctionName(run.index.function) << std::endl;
+    }
+    std::cout << "----------------------" << std::endl;
+
+    //2. Decide how to run it
+    //Shards and samples are picked by index bits, which other set counts and the hashed
+    //index functions do not keep
+    int shards = partitionShards(geometry, run.partition_threads);
+    int sampled_sets = 0;
+    if ((shards > 1 || run.sample_rate < 1.0) && (!geometry.powerOfTwoSets() || run.index.function != IndexFunction::Modulo)) {
+        std::cerr << "Error: PARTITION_THREADS and SAMPLE_RATE need a power-of-two number of sets and INDEX_FUNCTION MODULO." << std::endl;
+        return 1;
+    }
+    if (run.sample_rate < 1.0) {
+        sampled_sets = sampledSetCount(geometry, run.sample_rate);
+        if (sampled_sets == 0) {
+            return 1;
+        }
+    }
+
+    //Shards and samples renumber the sets, and the shadow cache, the victim cache and what
+    //follows the whole run are shared by every set
+    if (run.needsWholeCache() && (shards > 1 || sampled_sets > 0)) {
+        std::cerr << "Error: PREFETCHER, CLASSIFY_MISSES, VICTIM_CACHE_BLOCKS, PROFILE_FILE, INTERVAL_ACCESSES, PROGRESS_SECONDS, "
+            << "CHECKPOINT_FILE, RESUME_FILE and WARMUP_ACCESSES cannot be combined with PARTITION_THREADS or SAMPLE_RATE." << std::endl;
+        return 1;
+    }
+
+    //The checkpoint holds the cache, not the TLBs and the page table
+    if (input.translation.enabled && (!run.checkpoint_filename.empty() || !run.resume_filename.empty())) {
+        std::cerr << "Error: CHECKPOINT_FILE and RESUME_FILE cannot be combined with TRANSLATION." << std::endl;
+        return 1;
+    }
+
+    //3. Process the trace file
+    std::unique_ptr<TraceReader> trace = openInput(input);
+    if (!trace) {
+        return 1;
+    }
+    std::unique_ptr<AddressTranslator> translator = translateInput(input, trace, 1, run.warmup_accesses);
+
+    CacheStats stats;
+    SampledStats sampled;
+    try {
+        if (sampled_sets > 0) {
+            std::cout << "Engine: sampling " << sampled_sets << " of " << (1 << geometry.index_bits) << " sets" << std::endl;
+            sampled = runSampled(*trace, geometry, run.policy, run.write_policy, run.write_miss_policy, sampled_sets);
+            stats = sampled.estimated();
+        }
+        else if (shards > 1) {
+            std::cout << "Engine: set-partitioned over " << shards << " threads" << std::endl;
+            stats = runPartitioned(*trace, geometry, run.policy, run.write_policy, run.write_miss_policy, shards);
+        }
+        else {
+            Cache cache(geometry, run.policy, run.write_policy, run.write_miss_policy);
+            cache.setIndexFunction(run.index);
+            cache.enablePrefetching(run.prefetch);
+            if (run.classify_misses) {
+                cache.enableMissClassification();
+            }
+            if (run.victim_blocks > 0) {
+                cache.enableVictimCache(run.victim_blocks);
+            }
+#ifdef CACHESIM_PROFILE
+            if (!run.profile_filename.empty()) {
+                cache.enableProfile(run.profile_top_evicted);
+            }
+#endif
+            std::cout << "Engine: " << (cache.isSpecialized() ? "specialized for " + std::to_string(run.associativity) + "-way, " +
+                std::to_string(run.block_size) + "B blocks" : std::string("generic")) << std::endl;
+
+            //Restore before the decode thread starts, so skipping a memory-mapped trace is free
+            long long first_access = 0;
+            if (!run.resume_filename.empty()) {
+                long long offset = 0;
+                if (!cache.restoreCheckpoint(run.resume_filename, offset)) {
+                    return 1;
+                }
+                if (run.resume_mode == ResumeMode::Continue) {
+                    if (trace->skip(offset) != offset) {
+                        std::cerr << "Error: The trace ends before the " << offset << " accesses of checkpoint " << run.resume_filename << std::endl;
+                        return 1;
+                    }
+                    first_access = offset;
+                }
+                else {
+                    cache.resetStats();
+                }
+                std::cout << "Resumed: " << run.resume_filename << " (" << resumeModeName(run.resume_mode) << ", " << offset
+                    << " accesses simulated)" << std::endl;
+            }
+            if (decode_thread) {
+                trace = pipelineTrace(std::move(trace));
+            }
+
+            RunOptions options;
+            options.warmup_accesses = run.warmup_accesses;
+            if (run.warmup_accesses > 0) {
+                std::cout << "Warmup: the first " << run.warmup_accesses << " accesses are not counted" << std::endl;
+            }
+            std::unique_ptr<IntervalLog> intervals;
+            if (run.interval_accesses > 0) {
+                intervals.reset(new IntervalLog(run.interval_accesses, run.interval_format));
+                if (!intervals->open(run.interval_filename)) {
+                    return 1;
+                }
+                intervals->start(first_access, cache.stats().hits, cache.stats().misses);
+                options.intervals = intervals.get();
+            }
+            std::unique_ptr<ProgressMeter> progress;
+            if (run.progress_seconds > 0.0) {
+                progress.reset(new ProgressMeter(run.progress_seconds, trace->totalRecords(), first_access));
+                options.progress = progress.get();
+            }
+            options.checkpoint_filename = run.checkpoint_filename;
+            options.checkpoint_accesses = run.checkpoint_accesses;
+
+            long long accesses = 0;
+            bool completed = simulateTrace(*trace, cache, first_access, options, accesses);
+            progress.reset();
+            if (!completed) {
+                return 1;
+            }
+            stats = cache.stats();
+            if (!run.checkpoint_filename.empty()) {
+                if (!cache.saveCheckpoint(run.checkpoint_filename, accesses)) {
+                    return 1;
+                }
+                std::cout << "Checkpoint: " << accesses << " accesses saved to " << run.checkpoint_filename << std::endl;
+            }
+            if (intervals) {
+                if (!intervals->close(accesses, stats.hits, stats.misses)) {
+                    return 1;
+                }
+                std::cout << "Intervals: every " << run.interval_accesses << " accesses written to " << run.interval_filename << std::endl;
+            }
+
+#ifdef CACHESIM_PROFILE
+            if (cache.profile() != nullptr) {
+                if (!cache.profile()->write(run.profile_filename, run.profile_format)) {
+                    return 1;
+                }
+                std::cout << "Profile: " << profileFormatName(run.profile_format) << " written to " << run.profile_filename
+                    << ((run.profile_format == ProfileFormat::Csv) ? "_*.csv" : "") << std::endl;
+            }
+#endif
+        }
+    }
+    catch (const std::exception& e) {
+        //An address that is not a number aborts the run, just like std::stoull used to
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    //4. Print the final results
+    std::cout << "\n--- Simulation Results ---" << std::endl;
+
+    std::cout << "Total Accesses: " << stats.accesses() << std::endl;
+    std::cout << "Hits: " << stats.hits << std::endl;
+    std::cout << "Misses: " << stats.misses << std::endl;
+
+	//Format hit rate as a percentage with 4 decimal places
+    std::cout << "Hit Rate: " << std::fixed << std::setprecision(4)
+        << (stats.hitRate() * 100.0) << "%";
+    if (sampled_sets > 0) {
+        //Estimated from the sampled sets, with its 95% confidence interval
+        std::cout << " +/- " << (sampled.half_width * 100.0) << "% (95% confidence, "
+            << sampled.sampled.accesses() << " accesses simulated)";
+    }
+    std::cout << std::endl;
+
+    if (run.classify_misses) {
+        std::cout << "Compulsory Misses: " << stats.compulsory_misses << std::endl;
+        std::cout << "Capacity Misses: " << stats.capacity_misses << std::endl;
+        std::cout << "Conflict Misses: " << stats.conflict_misses << std::endl;
+    }
+    if (run.victim_blocks > 0) {
+        std::cout << "Victim Cache Hits: " << stats.victim_hits << std::endl;
+        std::cout << "Hit Rate with Victim Cache: " << (stats.combinedHitRate() * 100.0) << "%" << std::endl;
+    }
+
+    //Traffic to the next level down (memory)
+    std::cout << "Fetches: " << stats.fetches << std::endl;
+    std::cout << "Write-Backs: " << stats.writebacks << std::endl;
+    std::cout << "Write-Throughs: " << stats.write_throughs << std::endl;
+    std::cout << "Memory Traffic: " << stats.trafficBytes(run.block_size) << " bytes" << std::endl;
+
+    if (run.prefetch.kind != PrefetcherKind::None) {
+        std::cout << "Prefetches Issued: " << stats.prefetches << std::endl;
+        std::cout << "Useful Prefetches: " << stats.useful_prefetches << " (" << stats.late_prefetches << " late)" << std::endl;
+        std::cout << "Useless Prefetches: " << stats.useless_prefetches << std::endl;
+        std::cout << "Pollution Misses: " << stats.pollution_misses << std::endl;
+        std::cout << "Prefetch Accuracy: " << (stats.prefetchAccuracy() * 100.0) << "%" << std::endl;
+        std::cout << "Prefetch Coverage: " << (stats.prefetchCoverage() * 100.0) << "%" << std::endl;
+    }
+    std::cout << "--------------------------" << std::endl;
+    if (translator) {
+        printTranslationResults(*translator);
+    }
+
+    return 0;
+}
+
+
+//What the command line asks for besides a plain run
+struct CommandLine {
+    std::string sweep_filename; //--sweep
+    bool stack_distance = false; //--stack-distance
+    std::vector<int> set_counts;
+};
+
+
+//Runs one configuration in the mode it (or the command line) asks for
+int runConfig(const Config& config, const CommandLine& command) {
+    //Generate a new trace for testing, unless told to use the existing one
+    TraceInput input;
+    if (!prepareInput(config, input)) {
+        return 1;
+    }
+
+    //SWEEP_THREADS: worker threads for the sweep or the stack distances, 0 (the default)
+    //uses every core
+    int sweep_threads = 0;
+    if (!config.read("SWEEP_THREADS", sweep_threads)) {
+        return 1;
+    }
+    if (!command.sweep_filename.empty()) {
+        return runSweepMode(command.sweep_filename, input, sweep_threads);
+    }
+
+    if (command.stack_distance) {
+        //BLOCK_SIZE_BYTES fixes the block size of the curves.
+        //STACK_DISTANCE_CSV optionally names a file for every point of the curves.
+        int block_size = 0;
+        std::string csv_filename;
+        if (!config.require("BLOCK_SIZE_BYTES") || !config.read("BLOCK_SIZE_BYTES", block_size) ||
+            !config.read("STACK_DISTANCE_CSV", csv_filename)) {
+            return 1;
+        }
+        return runStackDistanceMode(command.set_counts, block_size, input, csv_filename, sweep_threads);
+    }
+
+    //DECODE_THREAD decodes the next chunk on a second thread while this one simulates.
+    //On by default whenever there is more than one core.
+    bool decode_thread = hardwareThreads() > 1;
+    if (!config.readFlag("DECODE_THREAD", decode_thread)) {
+        return 1;
+    }
+
+    //CORES above 1 gives every core of a multi-core trace its own L1, kept coherent with
+    //COHERENCE (MESI or MOESI), and shares L2 (if LEVELS is 2) between them
+    int cores = 1;
+    if (!config.read("CORES", cores)) {
+        return 1;
+    }
+    if (cores < 1 || cores > 256) {
+        std::cerr << "Error: CORES must be between 1 and 256." << std::endl;
+        return 1;
+    }
+    if (cores > 1) {
+        input.core_ids = true;
+        CoherenceProtocol protocol = CoherenceProtocol::Mesi;
+        std::string name;
+        if (config.has("COHERENCE") && (!config.read("COHERENCE", name) || !parseCoherenceProtocol(name, protocol))) {
+            return 1;
+        }
+        std::vector<LevelConfig> levels;
+        if (!readHierarchyConfig(config, levels) || !checkCoherentLevels(levels)) {
+            return 1;
+        }
+        return runMultiCoreMode(levels, cores, protocol, input, decode_thread);
+    }
+
+    //LEVELS above 1 simulates a hierarchy, L2_..., L3_... keys describe the lower levels
+    int levels_count = 1;
+    if (!config.read("LEVELS", levels_count)) {
+        return 1;
+    }
+    if (levels_count > 1) {
+        std::vector<LevelConfig> levels;
+        if (!readHierarchyConfig(config, levels)) {
+            return 1;
+        }
+        return runHierarchyMode(levels, input, decode_thread);
+    }
+
+    CacheRunConfig run;
+    if (!readCacheRunConfig(config, run)) {
+        return 1;
+    }
+    return runCacheMode(run, input, decode_thread);
+}
+
+
+int main(int argc, char* argv[]) {
+    //KEY=VALUE arguments override config.ini, "--config NAME" runs only its [NAME] section.
+    //Whatever is left chooses the mode.
+    std::vector<std::pair<std::string, std::string>> overrides;
+    std::string section;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        std::string key, value;
+        if (std::string(argv[i]) == "--config" && i + 1 < argc) {
+            section = argv[++i];
+        }
+        else if (parseOverride(argv[i], key, value)) {
+            overrides.push_back(std::make_pair(key, value));
+        }
+        else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    //Anything else on the command line is a mistake, not a reason to run config.ini as it is
+    if (!args.empty() && args[0] != "--convert" && args[0] != "--sweep" && args[0] != "--stack-distance") {
+        std::cerr << "Error: Unknown argument " << args[0] << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--config NAME] [KEY=VALUE ...] [--sweep <sweep file> | --stack-distance [sets ...]]" << std::endl;
+        std::cerr << "       " << argv[0] << " --convert <text trace> <binary trace>" << std::endl;
+        return 1;
+    }
+
+    //"CacheSimulator --convert trace.txt trace.bin" turns a text trace into the binary format
+    if (!args.empty() && args[0] == "--convert") {
+        if (args.size() != 3) {
+            std::cerr << "Usage: " << argv[0] << " --convert <text trace> <binary trace>" << std::endl;
+            return 1;
+        }
+        return convertTextTrace(args[1], args[2]) ? 0 : 1;
+    }
+
+    //"CacheSimulator --sweep sweep.txt" simulates every configuration listed in the file
+    //over a single pass of the trace
+    CommandLine command;
+    if (!args.empty() && args[0] == "--sweep") {
+        if (args.size() != 2) {
+            std::cerr << "Usage: " << argv[0] << " --sweep <sweep file>" << std::endl;
+            return 1;
+        }
+        command.sweep_filename = args[1];
+    }
+
+    //"CacheSimulator --stack-distance [sets ...]" computes the LRU hit rate of every
+    //associativity for each number of sets (default 1, fully associative) in one pass
+    command.stack_distance = !args.empty() && args[0] == "--stack-distance";
+    for (std::size_t i = 1; command.stack_distance && i < args.size(); ++i) {
+        long long sets = 0;
+        if (!parseInteger(args[i], sets) || sets < INT_MIN || sets > INT_MAX) {
+            std::cerr << "Error: Bad number of sets " << args[i] << std::endl;
+            std::cerr << "Usage: " << argv[0] << " --stack-distance [sets ...]" << std::endl;
+            return 1;
+        }
+        command.set_counts.push_back((int)sets);
+    }
+    if (command.stack_distance && command.set_counts.empty()) {
+        command.set_counts.push_back(1);
+    }
+
+    //1. Parse the config file, with the command line on top of every configuration
+    std::vector<Config> configs;
+    if (!loadConfigs("config.ini", configs)) {
+        return 1;
+    }
+    for (Config& config : configs) {
+        for (const std::pair<std::string, std::string>& entry : overrides) {
+            config.set(entry.first, entry.second, "command line");
+        }
+    }
+    if (!section.empty()) {
+        std::vector<Config> selected;
+        for (const Config& config : configs) {
+            if (config.name() == section) {
+                selected.push_back(config);
+            }
+        }
+        if (selected.empty()) {
+            std::cerr << "Error: config.ini has no [" << section << "] section" << std::endl;
+            return 1;
+        }
+        configs.swap(selected);
+    }
+
+    //2. Run every configuration in turn, stopping at the first that fails
+    for (const Config& config : configs) {
+        if (!config.name().empty()) {
+            std::cout << "\n=== [" << config.name() << "] ===" << std::endl;
+        }
+        int status = runConfig(config, command);
+        if (status != 0) {
+            return status;
+        }
+        //Keys the run never read, most likely misspelled ones
+        config.warnUnusedKeys();
+    }
+    return 0;
+}